@@ -0,0 +1,208 @@
+//
+//  clustering_policy.cpp
+//  blocksci_cluster
+//
+
+#include "clustering_policy.hpp"
+
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/chain/raw_transaction.hpp>
+#include <blocksci/heuristics/tx_identification.hpp>
+#include <blocksci/scripts/script_variant.hpp>
+#include <blocksci/util/data_access.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace blocksci;
+
+void TxView::load(const Transaction &tx_) {
+    tx = tx_;
+    auto &access = tx.getAccess();
+    inputs.clear();
+    outputs.clear();
+    smallestInputValue = std::numeric_limits<uint64_t>::max();
+    for (auto &inout : tx.rawInputs()) {
+        auto value = inout.getValue();
+        inputs.push_back(TxInputView{Address{inout.toAddressNum, inout.getType(), access}, value, inout.linkedTxNum});
+        smallestInputValue = std::min(smallestInputValue, value);
+    }
+    for (auto &inout : tx.rawOutputs()) {
+        outputs.push_back(TxOutputView{Address{inout.toAddressNum, inout.getType(), access}, inout.getValue(), inout.linkedTxNum});
+    }
+}
+
+bool TxView::isCoinjoin() {
+    // Checked here as well so that most transactions don't fill the scratch vectors
+    if (inputs.size() < 2 || outputs.size() < 3) {
+        return false;
+    }
+    addressScratch.clear();
+    for (auto &input : inputs) {
+        addressScratch.push_back(input.address);
+    }
+    valueScratch.clear();
+    for (auto &output : outputs) {
+        valueScratch.push_back(output.value);
+    }
+    return heuristics::isCoinjoin(addressScratch, valueScratch);
+}
+
+namespace {
+    bool looksLikePeelingChain(const RawTransaction &tx) {
+        return tx.outputCount == 2 && tx.inputCount == 1;
+    }
+
+    void optimalChange(TxView &view) {
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            if (view.outputs[i].value >= view.smallestInputValue) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    // Loads the script of each remaining candidate, so it is best listed after cheaper filters
+    void freshChange(TxView &view) {
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            if (view.changeCandidates[i] && view.outputs[i].address.getScript().firstTxIndex() != view.tx.txNum) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    void typeChange(TxView &view) {
+        auto inputType = view.inputs[0].address.type;
+        auto allInputsSameType = std::all_of(view.inputs.begin(), view.inputs.end(), [&](const TxInputView &input) {
+            return input.address.type == inputType;
+        });
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            if (!allInputsSameType || view.outputs[i].address.type != inputType) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    void reuseChange(TxView &view) {
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            auto &address = view.outputs[i].address;
+            auto reused = std::any_of(view.inputs.begin(), view.inputs.end(), [&](const TxInputView &input) {
+                return input.address == address;
+            });
+            if (!reused) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    void powerOfTenChange(TxView &view) {
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            if (view.outputs[i].value % 1000000 == 0) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    void locktimeChange(TxView &view) {
+        auto &chain = *view.tx.getAccess().chain;
+        bool locktimeGreaterZero = view.tx.locktime() > 0;
+        for (size_t i = 0; i < view.outputs.size(); i++) {
+            auto spendingTxNum = view.outputs[i].spendingTxNum;
+            // Unspent outputs can't be ruled out
+            if (spendingTxNum != 0 && (chain.getTx(spendingTxNum)->locktime > 0) != locktimeGreaterZero) {
+                view.changeCandidates[i] = 0;
+            }
+        }
+    }
+
+    void peelingChange(TxView &view) {
+        auto &chain = *view.tx.getAccess().chain;
+        bool peeling = false;
+        if (view.inputs.size() == 1 && view.outputs.size() == 2) {
+            peeling = looksLikePeelingChain(*chain.getTx(view.inputs[0].spentTxNum));
+            for (auto &output : view.outputs) {
+                peeling = peeling || (output.spendingTxNum != 0 && looksLikePeelingChain(*chain.getTx(output.spendingTxNum)));
+            }
+        }
+        if (!peeling) {
+            std::fill(view.changeCandidates.begin(), view.changeCandidates.end(), 0);
+            return;
+        }
+        // The change of a peeling chain is the larger output
+        size_t change = view.outputs[0].value > view.outputs[1].value ? 0 : 1;
+        view.changeCandidates[1 - change] = 0;
+    }
+}
+
+ClusteringPolicy::ClusteringPolicy(const std::string &spec) {
+    std::stringstream ss(spec);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "legacy") {
+            linkInputs = true;
+            name = "legacy-change";
+        }
+        if (name == "multi-input") {
+            linkInputs = true;
+        } else if (name == "legacy-change") {
+            requireMultipleSpendable = true;
+            changeFilters.push_back(optimalChange);
+            changeFilters.push_back(freshChange);
+        } else if (name == "optimal-change") {
+            changeFilters.push_back(optimalChange);
+        } else if (name == "fresh-change") {
+            changeFilters.push_back(freshChange);
+        } else if (name == "type-change") {
+            changeFilters.push_back(typeChange);
+        } else if (name == "reuse-change") {
+            changeFilters.push_back(reuseChange);
+        } else if (name == "power-of-ten-change") {
+            changeFilters.push_back(powerOfTenChange);
+        } else if (name == "locktime-change") {
+            changeFilters.push_back(locktimeChange);
+            spendingDependent = true;
+        } else if (name == "peeling-change") {
+            changeFilters.push_back(peelingChange);
+            spendingDependent = true;
+        } else {
+            throw std::invalid_argument("Unknown clustering heuristic " + name);
+        }
+    }
+}
+
+void ClusteringPolicy::addLinks(TxView &view, std::vector<std::pair<Address, Address>> &links) const {
+    if (view.inputs.empty() || view.isCoinjoin()) {
+        return;
+    }
+
+    auto &firstAddress = view.inputs[0].address;
+    if (linkInputs) {
+        for (size_t i = 1; i < view.inputs.size(); i++) {
+            links.emplace_back(firstAddress, view.inputs[i].address);
+        }
+    }
+
+    if (changeFilters.empty()) {
+        return;
+    }
+    view.changeCandidates.clear();
+    size_t spendableCount = 0;
+    for (auto &output : view.outputs) {
+        auto spendable = output.address.isSpendable();
+        view.changeCandidates.push_back(spendable);
+        spendableCount += spendable;
+    }
+    if (requireMultipleSpendable && spendableCount < 2) {
+        return;
+    }
+    for (auto filter : changeFilters) {
+        filter(view);
+    }
+    auto candidateCount = std::count(view.changeCandidates.begin(), view.changeCandidates.end(), 1);
+    if (candidateCount == 1) {
+        auto change = std::find(view.changeCandidates.begin(), view.changeCandidates.end(), 1) - view.changeCandidates.begin();
+        links.emplace_back(view.outputs[static_cast<size_t>(change)].address, firstAddress);
+    }
+}
@@ -0,0 +1,89 @@
+//
+//  clustering_policy.hpp
+//  blocksci_cluster
+//
+
+#ifndef clustering_policy_hpp
+#define clustering_policy_hpp
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct TxInputView {
+    blocksci::Address address;
+    uint64_t value;
+    uint32_t spentTxNum;
+};
+
+struct TxOutputView {
+    blocksci::Address address;
+    uint64_t value;
+    // 0 if the output is unspent
+    uint32_t spendingTxNum;
+};
+
+/* A transaction decoded once from its raw inputs and outputs and shared by every heuristic of a policy. The
+ * vectors keep their capacity between transactions, so a thread can reuse one view without allocating.
+ */
+class TxView {
+    std::vector<blocksci::Address> addressScratch;
+    std::vector<uint64_t> valueScratch;
+
+public:
+    blocksci::Transaction tx;
+    std::vector<TxInputView> inputs;
+    std::vector<TxOutputView> outputs;
+    uint64_t smallestInputValue;
+
+    // Outputs that the change heuristics have not ruled out yet
+    std::vector<uint8_t> changeCandidates;
+
+    void load(const blocksci::Transaction &tx);
+
+    // heuristics::isCoinjoin over the decoded view, reusing the view's scratch space
+    bool isCoinjoin();
+};
+
+// Removes the outputs that a change heuristic rules out from view.changeCandidates
+using ChangeFilter = void (*)(TxView &view);
+
+/* Clustering heuristics selected by a comma separated list:
+ *   multi-input            link every input address of a transaction
+ *   legacy-change          the change heuristic of earlier BlockSci versions: optimal-change and fresh-change, used
+ *                          only when the transaction has more than one spendable output
+ *   optimal-change         outputs smaller than every input
+ *   fresh-change           outputs sending to an address for the first time
+ *   type-change            outputs of the same address type as all inputs
+ *   reuse-change           outputs sending back to an input address
+ *   power-of-ten-change    outputs whose value is not a multiple of 0.01 BTC
+ *   locktime-change        outputs spent by a transaction with the same locktime behavior
+ *   peeling-change         the larger output of a peeling chain
+ * "legacy" is the default of multi-input and legacy-change. The change heuristics listed are combined, and the
+ * change output is linked to the inputs when exactly one spendable output passes all of them. Coinjoin
+ * transactions are never linked. locktime-change and peeling-change look at the transactions spending each output,
+ * so their links can change as later blocks are added.
+ */
+class ClusteringPolicy {
+    std::vector<ChangeFilter> changeFilters;
+    bool linkInputs = false;
+    bool requireMultipleSpendable = false;
+    bool spendingDependent = false;
+
+public:
+    static constexpr const char *defaultSpec = "legacy";
+
+    // Throws std::invalid_argument for unknown heuristics
+    explicit ClusteringPolicy(const std::string &spec);
+
+    // True if links made for a transaction can change once its outputs are spent
+    bool dependsOnSpending() const { return spendingDependent; }
+
+    void addLinks(TxView &view, std::vector<std::pair<blocksci::Address, blocksci::Address>> &links) const;
+};
+
+#endif /* clustering_policy_hpp */
@@ -0,0 +1,76 @@
+//
+//  concurrent_disjoint_sets.hpp
+//  blocksci_cluster
+//
+
+#ifndef concurrent_disjoint_sets_hpp
+#define concurrent_disjoint_sets_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* Lock free union-find that any number of threads can update at once. Sets are linked by index: the root with
+ * the larger index is pointed at the one with the smaller index, so every parent is at most its child and no
+ * cycle can form. A link is a single compare and swap on the root, which only succeeds while it is still a root,
+ * and a failed link retries from the new roots.
+ *
+ * find uses path halving, pointing every other element on the path at its grandparent. Parents only ever move
+ * towards the root, so stale reads and lost halving updates from other threads leave the structure valid. That
+ * lets every access be relaxed. Threads that join after their updates see the final sets.
+ */
+class ConcurrentDisjointSets {
+    std::vector<std::atomic<uint32_t>> parents;
+
+public:
+    explicit ConcurrentDisjointSets(uint32_t size) : parents(size) {
+        for (uint32_t i = 0; i < size; i++) {
+            parents[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Continues from an earlier state, where every parent must be at most its index
+    explicit ConcurrentDisjointSets(const std::vector<uint32_t> &initialParents) : parents(initialParents.size()) {
+        for (size_t i = 0; i < initialParents.size(); i++) {
+            parents[i].store(initialParents[i], std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(parents.size());
+    }
+
+    uint32_t find(uint32_t index) {
+        while (true) {
+            auto parent = parents[index].load(std::memory_order_relaxed);
+            auto grandparent = parents[parent].load(std::memory_order_relaxed);
+            if (parent == grandparent) {
+                return parent;
+            }
+            // Losing this race is harmless since the winner also moved the pointer closer to the root
+            parents[index].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            index = grandparent;
+        }
+    }
+
+    void unite(uint32_t a, uint32_t b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return;
+            }
+            if (a < b) {
+                std::swap(a, b);
+            }
+            auto expected = a;
+            if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+};
+
+#endif /* concurrent_disjoint_sets_hpp */
@@ -6,123 +6,81 @@
 //  Copyright © 2017 Harry Kalodner. All rights reserved.
 //
 
-#include "dset/dset.h"
+#include "clustering_policy.hpp"
+#include "concurrent_disjoint_sets.hpp"
 
 #include <blocksci/blocksci.hpp>
 #include <blocksci/address/dedup_address.hpp>
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/chain/raw_block.hpp>
 #include <blocksci/util/data_access.hpp>
+#include <blocksci/util/parallel.hpp>
 #include <blocksci/script.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
-#include <map>
+#include <memory>
 #include <future>
+#include <string>
 
 #include <fstream>
 
+#include <sys/resource.h>
+
 using namespace blocksci;
 
-std::vector<std::pair<Address, Address>> process_transaction(const Transaction &tx) {
-    std::vector<std::pair<Address, Address>> pairsToUnion;
-    
-    if (!heuristics::isCoinjoin(tx) && !tx.isCoinbase()) {
-        auto inputs = tx.inputs();
-        auto firstAddress = inputs[0].getAddress();
-        for (uint16_t i = 1; i < inputs.size(); i++) {
-            pairsToUnion.emplace_back(firstAddress, inputs[i].getAddress());
-        }
-        
-        if (auto change = heuristics::uniqueChangeByLegacyHeuristic(tx)) {
-            pairsToUnion.emplace_back(change->getAddress(), firstAddress);
-        }
-    }
-    return pairsToUnion;
-}
+// Links buffered by each thread before they are applied to the union-find
+constexpr size_t linkBatchSize = 1 << 12;
 
-template <typename Job>
-void segmentWork(uint32_t start, uint32_t end, uint32_t segmentCount, Job job) {
-    uint32_t total = end - start;
+struct AddressDisjointSets {
+    ConcurrentDisjointSets disjoinSets;
+    // Indexed by dedup type since it is read for every link
+    std::array<uint32_t, DedupAddressType::size> addressStarts;
 
-    // Don't partition over threads if there are less items than segment count
-    if (total < segmentCount) {
-        for (uint32_t i = start; i < end; ++i) {
-            job(i);
-        }
-        return;
-    }
-
-    auto segmentSize = total / segmentCount;
-    auto segmentsRemaining = total % segmentCount;
-    std::vector<std::pair<uint32_t, uint32_t>> segments;
-    uint32_t i = 0;
-    while(i < total) {
-        uint32_t startSegment = i;
-        i += segmentSize;
-        if (segmentsRemaining > 0) {
-            i += 1;
-            segmentsRemaining--;
+    AddressDisjointSets(const std::vector<uint32_t> &initialParents, const std::unordered_map<DedupAddressType::Enum, uint32_t> &addressStarts_) : disjoinSets{initialParents} {
+        for (auto &pair : addressStarts_) {
+            addressStarts[static_cast<size_t>(pair.first)] = pair.second;
         }
-        uint32_t endSegment = i;
-        segments.emplace_back(startSegment + start, endSegment);
-    }
-    
-    std::vector<std::thread> threads;
-    for (uint32_t i = 0; i < segmentCount - 1; i++) {
-        auto segment = segments[i];
-        threads.emplace_back([segment, &job](){
-            for (uint32_t i = segment.first; i < segment.second; i++) {
-                job(i);
-            }
-        });
-    }
-    
-    auto segment = segments.back();
-    for (uint32_t i = segment.first; i < segment.second; i++) {
-        job(i);
     }
-    
-    for (auto &thread : threads) {
-        thread.join();
-    }
-}
-
-struct AddressDisjointSets {
-    DisjointSets disjoinSets;
-    std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts;
-
-    AddressDisjointSets(uint32_t totalSize, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts_) : disjoinSets{totalSize}, addressStarts{std::move(addressStarts_)} {}
 
     uint32_t size() const {
         return disjoinSets.size();
     }
 
     void link_addresses(const Address &address1, const Address &address2) {
-        auto firstAddressIndex = addressStarts.at(dedupType(address1.type)) + address1.scriptNum - 1;
-        auto secondAddressIndex = addressStarts.at(dedupType(address2.type)) + address2.scriptNum - 1;
+        auto firstAddressIndex = addressStarts[static_cast<size_t>(dedupType(address1.type))] + address1.scriptNum - 1;
+        auto secondAddressIndex = addressStarts[static_cast<size_t>(dedupType(address2.type))] + address2.scriptNum - 1;
         disjoinSets.unite(firstAddressIndex, secondAddressIndex);
     }
 
-    void resolveAll() {
-        segmentWork(0, disjoinSets.size(), 8, [&](uint32_t index) {
-            disjoinSets.find(index);
+    // Only valid once every link has finished
+    std::vector<uint32_t> resolveAll() {
+        std::vector<uint32_t> parents(disjoinSets.size());
+        parallelCollect(getThreadPool(), 0, disjoinSets.size(), parents.begin(), [&](uint32_t index) {
+            return disjoinSets.find(index);
         });
-    }
-
-    uint32_t find(uint32_t index) {
-        return disjoinSets.find(index);
+        return parents;
     }
 };
 
-std::vector<uint32_t> getClusters(Blockchain &chain, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts, uint32_t totalScriptCount) {
+// Extends the clustering in initialParents, which already holds the links of every transaction below start
+std::vector<uint32_t> getClusters(Blockchain &chain, const ClusteringPolicy &policy, const std::unordered_map<DedupAddressType::Enum, uint32_t> &addressStarts, std::vector<uint32_t> initialParents, BlockHeight start, BlockHeight stop) {
     
-    AddressDisjointSets ds(totalScriptCount, std::move(addressStarts));
+    AddressDisjointSets ds(initialParents, addressStarts);
+    initialParents.clear();
+    initialParents.shrink_to_fit();
     
     auto &access = chain.getAccess();
 
     auto scriptHashCount = chain.addressCount(AddressType::SCRIPTHASH);
     
-    
-    segmentWork(1, scriptHashCount + 1, 8, [&ds, &access](uint32_t index) {
+    // Spending a script hash reveals its wrapped address, so scripts linked by earlier runs are checked again
+    parallelFor(getThreadPool(), 1, scriptHashCount + 1, [&ds, &access](uint32_t index) {
         Address pointer(index, AddressType::SCRIPTHASH, access);
         script::ScriptHash scripthash{index, access};
         auto wrappedAddress = scripthash.getWrappedAddress();
@@ -131,37 +89,139 @@ std::vector<uint32_t> getClusters(Blockchain &chain, std::unordered_map<DedupAdd
         }
     });
     
-    auto extract = [&](const Transaction &tx) {
-        auto pairs = process_transaction(tx);
-        for (auto &pair : pairs) {
-            ds.link_addresses(pair.first, pair.second);
+    auto extract = [&](const std::vector<Block> &segment) {
+        TxView view;
+        std::vector<std::pair<Address, Address>> links;
+        links.reserve(linkBatchSize);
+        auto applyLinks = [&]() {
+            for (auto &link : links) {
+                ds.link_addresses(link.first, link.second);
+            }
+            links.clear();
+        };
+        for (auto &block : segment) {
+            RANGES_FOR(auto tx, block) {
+                view.load(tx);
+                policy.addLinks(view, links);
+                if (links.size() >= linkBatchSize) {
+                    applyLinks();
+                }
+            }
         }
+        applyLinks();
         return 0;
     };
     
-    chain.mapReduce<int>(0, chain.size() - 10, extract, [](int &a,int &) -> int & {return a;});
-    
-    ds.resolveAll();
+    chain.mapReduce<int>(start, stop, extract, [](int &a,int &) -> int & {return a;});
     
-    std::vector<uint32_t> parents;
-    parents.reserve(ds.size());
+    return ds.resolveAll();
+}
+
+std::vector<uint32_t> singletonParents(uint32_t totalScriptCount) {
+    std::vector<uint32_t> parents(totalScriptCount);
     for (uint32_t i = 0; i < totalScriptCount; i++) {
-        parents.push_back(ds.find(i));
+        parents[i] = i;
     }
     return parents;
 }
 
+/* Saved next to the cluster files so that a later run only has to add the blocks after blockCount. Links are
+ * made between scripts created anywhere in the chain, including the unclustered blocks at its end, so the
+ * state is only reused while the block that ended the chain is still in it. A reorg past that block can give
+ * the same script numbers to different scripts.
+ */
+struct ClusteringState {
+    BlockHeight blockCount;
+    std::array<uint32_t, DedupAddressType::size> scriptCounts;
+    BlockHeight tipHeight;
+    uint256 tipHash;
+};
+
+const char *clusteringStateFile = "clusterState.dat";
+const char *clusterParentsFile = "clusterParents.dat";
+const char *clusterPolicyFile = "clusterPolicy.txt";
+
+void saveClusteringState(const ClusteringState &state, const std::vector<uint32_t> &parents, const std::string &policySpec) {
+    {
+        std::ofstream parentsFile(clusterParentsFile, std::ios::binary);
+        parentsFile.write(reinterpret_cast<const char *>(parents.data()), static_cast<std::streamsize>(sizeof(uint32_t) * parents.size()));
+    }
+    {
+        std::ofstream policyFile(clusterPolicyFile);
+        policyFile << policySpec << "\n";
+    }
+    std::ofstream stateFile(clusteringStateFile, std::ios::binary);
+    stateFile.write(reinterpret_cast<const char *>(&state), sizeof(state));
+}
+
+/* Loads the parents saved by an earlier run into the current layout of script numbers. Types are laid out one
+ * after another, so growing script counts shift later types upwards without changing the order of any two
+ * addresses and each root stays the smallest index of its set.
+ */
+bool loadClusteringState(ClusteringState &state, std::vector<uint32_t> &parents, const ClusteringState &current, const ChainAccess &chainAccess, const std::string &policySpec, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts, uint32_t totalScriptCount) {
+    std::ifstream stateFile(clusteringStateFile, std::ios::binary);
+    if (!stateFile.read(reinterpret_cast<char *>(&state), sizeof(state))) {
+        std::cout << "No earlier clustering found\n";
+        return false;
+    }
+    std::ifstream policyFile(clusterPolicyFile);
+    std::string previousPolicySpec;
+    if (!std::getline(policyFile, previousPolicySpec) || previousPolicySpec != policySpec) {
+        std::cout << "Earlier clustering used a different policy\n";
+        return false;
+    }
+    if (state.blockCount > current.blockCount || state.tipHeight > current.tipHeight || chainAccess.getBlock(state.tipHeight)->hash != state.tipHash) {
+        std::cout << "Earlier clustering covers blocks that are no longer in the chain\n";
+        return false;
+    }
+    std::array<uint32_t, DedupAddressType::size> oldStarts;
+    std::array<uint32_t, DedupAddressType::size> newStarts;
+    uint32_t oldTotal = 0;
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        if (state.scriptCounts[i] > current.scriptCounts[i]) {
+            std::cout << "Earlier clustering includes scripts that are no longer in the chain\n";
+            return false;
+        }
+        oldStarts[i] = oldTotal;
+        oldTotal += state.scriptCounts[i];
+        newStarts[i] = scriptStarts.at(DedupAddressType::all[i]);
+    }
+    
+    std::vector<uint32_t> oldParents(oldTotal);
+    std::ifstream parentsFile(clusterParentsFile, std::ios::binary);
+    if (!parentsFile.read(reinterpret_cast<char *>(oldParents.data()), static_cast<std::streamsize>(sizeof(uint32_t) * oldParents.size()))) {
+        std::cout << "Earlier cluster parents are missing or incomplete\n";
+        return false;
+    }
+    
+    auto remapIndex = [&](uint32_t oldIndex) {
+        size_t type = DedupAddressType::size - 1;
+        while (oldIndex < oldStarts[type]) {
+            type--;
+        }
+        return newStarts[type] + (oldIndex - oldStarts[type]);
+    };
+    parents = singletonParents(totalScriptCount);
+    parallelFor(getThreadPool(), 0, DedupAddressType::size, [&](uint32_t type) {
+        for (uint32_t i = 0; i < state.scriptCounts[type]; i++) {
+            parents[newStarts[type] + i] = remapIndex(oldParents[oldStarts[type] + i]);
+        }
+    });
+    return true;
+}
+
+// Every root is the smallest index of its set, so it is renumbered before any other member and each entry can
+// take the new id from its root's entry without a second table
 uint32_t remapClusterIds(std::vector<uint32_t> &parents) {
-    uint32_t placeholder = std::numeric_limits<uint32_t>::max();
-    std::vector<uint32_t> newClusterIds(parents.size(), placeholder);
     uint32_t clusterCount = 0;
-    for (uint32_t &clusterNum : parents) {
-        uint32_t &clusterId = newClusterIds[clusterNum];
-        if (clusterId == placeholder) {
-            clusterId = clusterCount;
+    for (uint32_t i = 0; i < parents.size(); i++) {
+        auto root = parents[i];
+        if (root == i) {
+            parents[i] = clusterCount;
             clusterCount++;
+        } else {
+            parents[i] = parents[root];
         }
-        clusterNum = clusterId;
     }
     
     std::cout << "ClusterCount is " << clusterCount << "\n";
@@ -169,32 +229,202 @@ uint32_t remapClusterIds(std::vector<uint32_t> &parents) {
     return clusterCount;
 }
 
+// Largest number of addresses gathered in memory at once while ordering them by cluster
+constexpr uint32_t orderedWindowSize = 1 << 27;
+
+/* Writes the addresses of every cluster contiguously in cluster order. The counting sort fills one window of
+ * consecutive clusters at a time, holding at most orderedWindowSize addresses unless a single cluster is larger,
+ * and appends it to the file, so memory stays bounded however many scripts there are.
+ */
 void recordOrderedAddresses(const std::vector<uint32_t> &parent, std::vector<uint32_t> &clusterPositions, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts) {
+    // Types are laid out in the order of DedupAddressType::all
+    std::vector<std::pair<uint32_t, uint32_t>> typeRanges;
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        auto typeStart = scriptStarts.at(DedupAddressType::all[i]);
+        auto typeEnd = i + 1 < DedupAddressType::size ? scriptStarts.at(DedupAddressType::all[i + 1]) : static_cast<uint32_t>(parent.size());
+        typeRanges.emplace_back(typeStart, typeEnd);
+    }
     
-    std::map<uint32_t, DedupAddressType::Enum> typeIndexes;
+    std::ofstream clusterAddressesFile("clusterAddresses.dat", std::ios::binary);
+    auto clusterCount = static_cast<uint32_t>(clusterPositions.size() - 1);
+    std::vector<DedupAddress> window;
+    uint32_t clusterBegin = 0;
+    while (clusterBegin < clusterCount) {
+        auto windowStart = clusterPositions[clusterBegin];
+        auto clusterEnd = clusterBegin + 1;
+        while (clusterEnd < clusterCount && clusterPositions[clusterEnd + 1] - windowStart <= orderedWindowSize) {
+            clusterEnd++;
+        }
+        auto windowEnd = clusterPositions[clusterEnd];
+        window.resize(windowEnd - windowStart);
+        
+        for (size_t typeIndex = 0; typeIndex < typeRanges.size(); typeIndex++) {
+            auto type = DedupAddressType::all[typeIndex];
+            auto &range = typeRanges[typeIndex];
+            for (uint32_t i = range.first; i < range.second; i++) {
+                auto clusterNum = parent[i];
+                if (clusterNum >= clusterBegin && clusterNum < clusterEnd) {
+                    uint32_t &j = clusterPositions[clusterNum];
+                    window[j - windowStart] = DedupAddress(i - range.first + 1, type);
+                    j++;
+                }
+            }
+        }
+        
+        clusterAddressesFile.write(reinterpret_cast<const char *>(window.data()), static_cast<std::streamsize>(sizeof(DedupAddress) * window.size()));
+        clusterBegin = clusterEnd;
+    }
+}
+
+template <typename T>
+void writeClusterColumn(const char *path, const std::vector<std::atomic<T>> &column) {
+    std::vector<T> values;
+    values.reserve(column.size());
+    for (auto &value : column) {
+        values.push_back(value.load(std::memory_order_relaxed));
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(sizeof(T) * values.size()));
+}
+
+template <typename T, typename Compare>
+void updateExtreme(std::atomic<T> &extreme, T value, Compare compare) {
+    auto current = extreme.load(std::memory_order_relaxed);
+    while (compare(value, current) && !extreme.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+/* Writes one column per aggregate of every cluster over the whole chain: the value it currently holds, the total
+ * value it received, how many outputs it received, how many transactions it took part in and the first and last
+ * block of those transactions. This includes the last blocks of the chain that are left out of the linking, so
+ * balances are current. Clusters that never appear in a transaction, such as keys only used inside multisigs,
+ * get -1 for both blocks. Blocks are scanned in parallel using the raw inputs and outputs, which already carry
+ * their addresses, so no address index lookups are needed.
+ */
+void recordClusterAggregates(Blockchain &chain, const std::vector<uint32_t> &clusterIds, uint32_t clusterCount, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts) {
+    std::array<uint32_t, DedupAddressType::size> starts;
     for (auto &pair : scriptStarts) {
-        typeIndexes[pair.second] = pair.first;
+        starts[static_cast<size_t>(pair.first)] = pair.second;
     }
     
-    std::vector<DedupAddress> orderedScripts;
-    orderedScripts.resize(parent.size());
+    std::vector<std::atomic<uint64_t>> balances(clusterCount);
+    std::vector<std::atomic<uint64_t>> received(clusterCount);
+    std::vector<std::atomic<uint32_t>> outputCounts(clusterCount);
+    std::vector<std::atomic<uint32_t>> txCounts(clusterCount);
+    std::vector<std::atomic<BlockHeight>> firstBlocks(clusterCount);
+    std::vector<std::atomic<BlockHeight>> lastBlocks(clusterCount);
+    parallelFor(getThreadPool(), 0, clusterCount, [&](uint32_t i) {
+        balances[i].store(0, std::memory_order_relaxed);
+        received[i].store(0, std::memory_order_relaxed);
+        outputCounts[i].store(0, std::memory_order_relaxed);
+        txCounts[i].store(0, std::memory_order_relaxed);
+        firstBlocks[i].store(-1, std::memory_order_relaxed);
+        lastBlocks[i].store(-1, std::memory_order_relaxed);
+    });
     
-    for (uint32_t i = 0; i < parent.size(); i++) {
-        uint32_t &j = clusterPositions[parent[i]];
-        auto it = typeIndexes.upper_bound(i);
-        it--;
-        uint32_t addressNum = i - it->first + 1;
-        auto addressType = it->second;
-        orderedScripts[j] = DedupAddress(addressNum, addressType);
-        j++;
-    }
+    auto maxLoadedTx = chain.getAccess().chain->maxLoadedTx();
+    auto clusterOf = [&](const Inout &inout) {
+        return clusterIds[starts[static_cast<size_t>(dedupType(inout.getType()))] + inout.toAddressNum - 1];
+    };
     
-    std::ofstream clusterAddressesFile("clusterAddresses.dat", std::ios::binary);
-    clusterAddressesFile.write(reinterpret_cast<char *>(orderedScripts.data()), sizeof(DedupAddress) * orderedScripts.size());
+    auto aggregate = [&](const std::vector<Block> &segment) {
+        std::vector<uint32_t> txClusters;
+        for (auto &block : segment) {
+            auto height = block.height();
+            RANGES_FOR(auto tx, block) {
+                txClusters.clear();
+                for (auto &inout : tx.rawInputs()) {
+                    if (inout.toAddressNum != 0) {
+                        txClusters.push_back(clusterOf(inout));
+                    }
+                }
+                for (auto &inout : tx.rawOutputs()) {
+                    if (inout.toAddressNum != 0) {
+                        auto clusterNum = clusterOf(inout);
+                        auto value = inout.getValue();
+                        received[clusterNum].fetch_add(value, std::memory_order_relaxed);
+                        outputCounts[clusterNum].fetch_add(1, std::memory_order_relaxed);
+                        // Outputs spent in ignored blocks count as unspent, as in isSpentRaw
+                        if (inout.linkedTxNum == 0 || inout.linkedTxNum >= maxLoadedTx) {
+                            balances[clusterNum].fetch_add(value, std::memory_order_relaxed);
+                        }
+                        txClusters.push_back(clusterNum);
+                    }
+                }
+                std::sort(txClusters.begin(), txClusters.end());
+                txClusters.erase(std::unique(txClusters.begin(), txClusters.end()), txClusters.end());
+                for (auto clusterNum : txClusters) {
+                    txCounts[clusterNum].fetch_add(1, std::memory_order_relaxed);
+                    updateExtreme(firstBlocks[clusterNum], height, [](BlockHeight block, BlockHeight first) {
+                        return first < 0 || block < first;
+                    });
+                    updateExtreme(lastBlocks[clusterNum], height, std::greater<BlockHeight>());
+                }
+            }
+        }
+        return 0;
+    };
+    chain.mapReduce<int>(0, static_cast<BlockHeight>(chain.size()), aggregate, [](int &a,int &) -> int & {return a;});
+    
+    writeClusterColumn("clusterBalances.dat", balances);
+    writeClusterColumn("clusterReceived.dat", received);
+    writeClusterColumn("clusterOutputCounts.dat", outputCounts);
+    writeClusterColumn("clusterTxCounts.dat", txCounts);
+    writeClusterColumn("clusterFirstBlocks.dat", firstBlocks);
+    writeClusterColumn("clusterLastBlocks.dat", lastBlocks);
+}
+
+// Called before any cluster file is rewritten, so that a run stopped part way never leaves the aggregates of an
+// older clustering next to the new clusters
+void removeClusterAggregates() {
+    for (auto path : {"clusterBalances.dat", "clusterReceived.dat", "clusterOutputCounts.dat", "clusterTxCounts.dat", "clusterFirstBlocks.dat", "clusterLastBlocks.dat"}) {
+        std::remove(path);
+    }
+}
+
+void reportPeakMemory() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // Reported in bytes on macOS and in kilobytes elsewhere
+    auto peakBytes = static_cast<double>(usage.ru_maxrss);
+#else
+    auto peakBytes = static_cast<double>(usage.ru_maxrss) * 1024;
+#endif
+    std::cout << "Peak memory usage was " << peakBytes / (1024 * 1024 * 1024) << " GB\n";
 }
 
 int main(int argc, const char * argv[]) {
-    assert(argc == 2);
+    if (argc < 2) {
+        std::cout << "Usage: clusterer <data directory> [--policy heuristics] [--incremental] [--verify]\n";
+        return 1;
+    }
+    // --incremental extends the clustering saved in the working directory with the blocks added since it was made.
+    // --verify also clusters from scratch and checks that both agree. --policy selects the heuristics as described
+    // in clustering_policy.hpp. Policies whose links depend on later spends are always clustered from scratch
+    bool incremental = false;
+    bool verify = false;
+    std::string policySpec = ClusteringPolicy::defaultSpec;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--policy" && i + 1 < argc) {
+            policySpec = argv[++i];
+        } else if (arg == "--incremental") {
+            incremental = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else {
+            std::cout << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    
+    std::unique_ptr<ClusteringPolicy> policy;
+    try {
+        policy = std::make_unique<ClusteringPolicy>(policySpec);
+    } catch (const std::invalid_argument &e) {
+        std::cout << e.what() << "\n";
+        return 1;
+    }
     
     auto progStart = std::chrono::steady_clock::now();
     
@@ -211,8 +441,40 @@ int main(int argc, const char * argv[]) {
         }
     }
     
+    ClusteringState currentState;
+    currentState.blockCount = static_cast<BlockHeight>(chain.size()) - 10;
+    currentState.tipHeight = static_cast<BlockHeight>(chain.size()) - 1;
+    currentState.tipHash = chain.getAccess().chain->getBlock(currentState.tipHeight)->hash;
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        currentState.scriptCounts[i] = scripts.scriptCount(DedupAddressType::all[i]);
+    }
+    
     auto allClusterStart = std::chrono::steady_clock::now();
-    auto parent = getClusters(chain, scriptStarts, static_cast<uint32_t>(totalScriptCount));
+    ClusteringState previousState;
+    std::vector<uint32_t> startParents;
+    BlockHeight startBlock = 0;
+    if (incremental && policy->dependsOnSpending()) {
+        std::cout << "Policy " << policySpec << " depends on later spends, so clustering from scratch\n";
+        incremental = false;
+    }
+    if (incremental && loadClusteringState(previousState, startParents, currentState, *chain.getAccess().chain, policySpec, scriptStarts, static_cast<uint32_t>(totalScriptCount))) {
+        startBlock = previousState.blockCount;
+        std::cout << "Extending clustering from block " << startBlock << " to " << currentState.blockCount << "\n";
+    } else {
+        startParents = singletonParents(static_cast<uint32_t>(totalScriptCount));
+    }
+    auto parent = getClusters(chain, *policy, scriptStarts, std::move(startParents), startBlock, currentState.blockCount);
+    if (verify && policy->dependsOnSpending()) {
+        std::cout << "Policy depends on later spends, so the clustering was computed from scratch and not verified\n";
+    } else if (verify) {
+        auto fullParent = getClusters(chain, *policy, scriptStarts, singletonParents(static_cast<uint32_t>(totalScriptCount)), 0, currentState.blockCount);
+        if (fullParent != parent) {
+            std::cout << "Clustering does not match a full recompute\n";
+            return 1;
+        }
+        std::cout << "Clustering matches a full recompute\n";
+    }
+    saveClusteringState(currentState, parent, policySpec);
     std::cout << "Finished main clustering in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - allClusterStart).count() / 1000000.0 << " seconds\n";
     uint32_t clusterCount = remapClusterIds(parent);
     std::cout << "Finished remapping in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - allClusterStart).count() / 1000000.0 << " seconds\n";
@@ -228,9 +490,12 @@ int main(int argc, const char * argv[]) {
     
     std::cout << "Finished position tracking in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - allClusterStart).count() / 1000000.0 << " seconds\n";
     
-    auto recordOrdered = std::async(std::launch::async, recordOrderedAddresses, parent, std::ref(clusterPositions), scriptStarts);
+    removeClusterAggregates();
+    
+    // The writers below only read parent, so it is shared rather than copied
+    auto recordOrdered = std::async(std::launch::async, recordOrderedAddresses, std::cref(parent), std::ref(clusterPositions), std::cref(scriptStarts));
     
-    segmentWork(0, DedupAddressType::size, DedupAddressType::size, [&scriptStarts, &scripts, &parent](uint32_t index) {
+    parallelFor(getThreadPool(), 0, DedupAddressType::size, [&scriptStarts, &scripts, &parent](uint32_t index) {
         auto type = DedupAddressType::all[index];
         uint32_t startIndex = scriptStarts[type];
         uint32_t totalCount = scripts.scriptCount(type);
@@ -240,12 +505,17 @@ int main(int argc, const char * argv[]) {
         clusterIndexFile.write(reinterpret_cast<char *>(parent.data() + startIndex), sizeof(uint32_t) * totalCount);
     });
     
+    auto aggregatesStart = std::chrono::steady_clock::now();
+    recordClusterAggregates(chain, parent, clusterCount, scriptStarts);
+    std::cout << "Finished cluster aggregates in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - aggregatesStart).count() / 1000000.0 << " seconds\n";
+    
     recordOrdered.get();
     
     std::ofstream clusterOffsetFile("clusterOffsets.dat", std::ios::binary);
     clusterOffsetFile.write(reinterpret_cast<char *>(clusterPositions.data()), sizeof(uint32_t) * clusterPositions.size());
     
     std::cout << "Finished whole program in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - progStart).count() / 1000000.0 << " seconds\n";
+    reportPeakMemory();
     
     return 0;
 }
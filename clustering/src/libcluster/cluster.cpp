@@ -21,7 +21,7 @@
 std::vector<blocksci::Address> Cluster::getAddresses() const {
     std::vector<blocksci::Address> addresses;
     for (auto &dedupAddress : manager.getClusterScripts(clusterNum)) {
-        for (auto &address : blocksci::EquivAddress(dedupAddress, false, manager.access)) {
+        for (auto address : blocksci::EquivAddress(dedupAddress, false, manager.access)) {
             addresses.push_back(address);
         }
     }
@@ -39,7 +39,7 @@ std::vector<TaggedAddress> Cluster::taggedAddresses(const std::unordered_map<blo
     auto &access = tags.begin()->first.getAccess();
     std::vector<TaggedAddress> tagged;
     for (auto &dedupAddress : manager.getClusterScripts(clusterNum)) {
-        for (auto &address : blocksci::EquivAddress(dedupAddress, false, access)) {
+        for (auto address : blocksci::EquivAddress(dedupAddress, false, access)) {
             auto it = tags.find(address);
             if (it != tags.end()) {
                 tagged.emplace_back(it->first, it->second);
@@ -66,7 +66,7 @@ uint32_t Cluster::countOfType(blocksci::AddressType::Enum type) const {
 std::vector<blocksci::OutputPointer> Cluster::getOutputPointers() const {
     std::vector<blocksci::OutputPointer> pointers;
     for (auto &dedupAddress : manager.getClusterScripts(clusterNum)) {
-        for (auto &address : blocksci::EquivAddress(dedupAddress, false, manager.access)) {
+        for (auto address : blocksci::EquivAddress(dedupAddress, false, manager.access)) {
             auto addrOuts = address.getOutputPointers();
             pointers.insert(pointers.end(), addrOuts.begin(), addrOuts.end());
         }
@@ -78,6 +78,10 @@ uint64_t Cluster::calculateBalance(blocksci::BlockHeight height) const {
     return blocksci::calculateBalance(getOutputPointers(), height, manager.access);
 }
 
+ClusterAggregate Cluster::getAggregate() const {
+    return manager.getClusterAggregate(clusterNum);
+}
+
 std::vector<blocksci::Output> Cluster::getOutputs() const {
     return blocksci::getOutputs(getOutputPointers(), manager.access);
 }
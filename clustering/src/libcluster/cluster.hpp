@@ -18,6 +18,7 @@
 #include <cstdint>
 
 class ClusterManager;
+struct ClusterAggregate;
 
 struct TaggedAddress {
     blocksci::Address address;
@@ -43,6 +44,7 @@ public:
 
     std::vector<blocksci::OutputPointer> getOutputPointers() const;
     uint64_t calculateBalance(blocksci::BlockHeight height) const;
+    ClusterAggregate getAggregate() const;
     std::vector<blocksci::Output> getOutputs() const;
     std::vector<blocksci::Input> getInputs() const;
     std::vector<blocksci::Transaction> getTransactions() const;
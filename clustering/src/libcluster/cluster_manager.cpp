@@ -15,6 +15,12 @@
 ClusterManager::ClusterManager(const boost::filesystem::path &baseDirectory, const blocksci::DataAccess &access_) : 
     clusterOffsetFile(baseDirectory/"clusterOffsets"), 
     clusterScriptsFile(baseDirectory/"clusterAddresses"), 
+    clusterBalanceFile(baseDirectory/"clusterBalances"),
+    clusterReceivedFile(baseDirectory/"clusterReceived"),
+    clusterOutputCountFile(baseDirectory/"clusterOutputCounts"),
+    clusterTxCountFile(baseDirectory/"clusterTxCounts"),
+    clusterFirstBlockFile(baseDirectory/"clusterFirstBlocks"),
+    clusterLastBlockFile(baseDirectory/"clusterLastBlocks"),
     scriptClusterIndexFiles(blocksci::apply(blocksci::DedupAddressInfoList(), [&] (auto tag) {
         std::stringstream ss;
         ss << blocksci::dedupAddressName(tag) << "_cluster_index";
@@ -95,3 +101,29 @@ boost::iterator_range<const blocksci::DedupAddress *> ClusterManager::getCluster
     
     return boost::make_iterator_range_n(firstAddressOffset, clusterSize);
 }
+
+bool ClusterManager::hasAggregates() const {
+    // The offsets file holds one more entry than there are clusters
+    if (clusterOffsetFile.size() < 2) {
+        return false;
+    }
+    auto count = clusterOffsetFile.size() - 1;
+    return clusterBalanceFile.size() == count && clusterReceivedFile.size() == count && clusterOutputCountFile.size() == count && clusterTxCountFile.size() == count && clusterFirstBlockFile.size() == count && clusterLastBlockFile.size() == count;
+}
+
+ClusterAggregate ClusterManager::getClusterAggregate(uint32_t clusterNum) const {
+    if (!hasAggregates()) {
+        throw std::runtime_error("Cluster aggregates have not been generated for these clusters");
+    }
+    if (clusterNum >= clusterBalanceFile.size()) {
+        throw std::out_of_range("Cluster number is out of range");
+    }
+    return ClusterAggregate{
+        *clusterBalanceFile.getData(clusterNum),
+        *clusterReceivedFile.getData(clusterNum),
+        *clusterOutputCountFile.getData(clusterNum),
+        *clusterTxCountFile.getData(clusterNum),
+        *clusterFirstBlockFile.getData(clusterNum),
+        *clusterLastBlockFile.getData(clusterNum)
+    };
+}
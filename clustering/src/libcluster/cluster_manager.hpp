@@ -21,6 +21,7 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <stdexcept>
 #include <stdio.h>
 
 class Cluster;
@@ -40,10 +41,31 @@ struct TaggedCluster {
     TaggedCluster(const Cluster &cluster_, std::vector<TaggedAddress> &&taggedAddresses_) : cluster(cluster_), taggedAddresses(taggedAddresses_) {}
 };
 
+// Totals of a cluster over every block of the chain when the clusterer ran, including the last blocks it leaves out of linking
+struct ClusterAggregate {
+    // Value of the outputs sent to the cluster that were unspent
+    uint64_t balance;
+    uint64_t totalReceived;
+    uint32_t outputCount;
+    // Transactions with an input or output of the cluster
+    uint32_t txCount;
+    // -1 for clusters that never appeared in a transaction
+    blocksci::BlockHeight firstBlock;
+    blocksci::BlockHeight lastBlock;
+};
+
 class ClusterManager {
     blocksci::FixedSizeFileMapper<uint32_t> clusterOffsetFile;
     blocksci::FixedSizeFileMapper<blocksci::DedupAddress> clusterScriptsFile;
     
+    // One column per aggregate, indexed by cluster number
+    blocksci::FixedSizeFileMapper<uint64_t> clusterBalanceFile;
+    blocksci::FixedSizeFileMapper<uint64_t> clusterReceivedFile;
+    blocksci::FixedSizeFileMapper<uint32_t> clusterOutputCountFile;
+    blocksci::FixedSizeFileMapper<uint32_t> clusterTxCountFile;
+    blocksci::FixedSizeFileMapper<blocksci::BlockHeight> clusterFirstBlockFile;
+    blocksci::FixedSizeFileMapper<blocksci::BlockHeight> clusterLastBlockFile;
+    
     using ScriptClusterIndexTuple = blocksci::to_dedup_address_tuple_t<ScriptClusterIndexFile>;
     
     ScriptClusterIndexTuple scriptClusterIndexFiles;
@@ -55,6 +77,14 @@ class ClusterManager {
     friend struct ClusterNumFunctor;
 
     boost::iterator_range<const blocksci::DedupAddress *> getClusterScripts(uint32_t clusterNum) const;
+    
+    template<typename T>
+    boost::iterator_range<const T *> getAggregateColumn(const blocksci::FixedSizeFileMapper<T> &file) const {
+        if (!hasAggregates()) {
+            throw std::runtime_error("Cluster aggregates have not been generated for these clusters");
+        }
+        return boost::make_iterator_range_n(file.getData(0), file.size());
+    }
 
     template<blocksci::DedupAddressType::Enum type>
     uint32_t getClusterNumImpl(uint32_t scriptNum) const {
@@ -78,6 +108,36 @@ public:
     
     std::vector<uint32_t> getClusterSizes() const;
     
+    // False for clusterings made before aggregates were added, or whose aggregates were not written for these clusters
+    bool hasAggregates() const;
+    
+    // Throws if the aggregates have not been generated
+    ClusterAggregate getClusterAggregate(uint32_t clusterNum) const;
+    
+    boost::iterator_range<const uint64_t *> getClusterBalances() const {
+        return getAggregateColumn(clusterBalanceFile);
+    }
+    
+    boost::iterator_range<const uint64_t *> getClusterTotalReceived() const {
+        return getAggregateColumn(clusterReceivedFile);
+    }
+    
+    boost::iterator_range<const uint32_t *> getClusterOutputCounts() const {
+        return getAggregateColumn(clusterOutputCountFile);
+    }
+    
+    boost::iterator_range<const uint32_t *> getClusterTxCounts() const {
+        return getAggregateColumn(clusterTxCountFile);
+    }
+    
+    boost::iterator_range<const blocksci::BlockHeight *> getClusterFirstBlocks() const {
+        return getAggregateColumn(clusterFirstBlockFile);
+    }
+    
+    boost::iterator_range<const blocksci::BlockHeight *> getClusterLastBlocks() const {
+        return getAggregateColumn(clusterLastBlockFile);
+    }
+    
     std::vector<TaggedCluster> taggedClusters(const std::unordered_map<blocksci::Address, std::string> &tags);
 };
 
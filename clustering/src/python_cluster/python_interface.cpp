@@ -16,6 +16,7 @@
 #include <blocksci/chain/output.hpp>
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
 namespace py = pybind11;
@@ -38,6 +39,12 @@ namespace pybind11 { namespace detail {
     };
 }}
 
+// Copies a column out of its memory mapped file so the array stays valid after the manager is gone
+template <typename T>
+py::array_t<T> aggregateArray(const boost::iterator_range<const T *> &column) {
+    return py::array_t<T>(column.size(), column.begin());
+}
+
 uint64_t totalOutWithoutSelfChurn(const Block &block, ClusterManager &manager) {
     uint64_t total = 0;
     for (auto tx : block) {
@@ -74,6 +81,26 @@ uint64_t totalOutWithoutSelfChurn(const Block &block, ClusterManager &manager) {
     .def("cluster_sizes", &ClusterManager::getClusterSizes, "Get a list of all cluster sizes (This is quite slow)")
     .def("tagged_clusters", &ClusterManager::taggedClusters
        , "Given a dictionary of tags, return a list of TaggedCluster objects for any clusters containing tagged scripts")
+    .def("has_aggregates", &ClusterManager::hasAggregates, "Return whether the clusterer generated per cluster aggregates")
+    .def("aggregates", [](const ClusterManager &cm) {
+        py::dict columns;
+        columns["balance"] = aggregateArray(cm.getClusterBalances());
+        columns["total_received"] = aggregateArray(cm.getClusterTotalReceived());
+        columns["output_count"] = aggregateArray(cm.getClusterOutputCounts());
+        columns["tx_count"] = aggregateArray(cm.getClusterTxCounts());
+        columns["first_block"] = aggregateArray(cm.getClusterFirstBlocks());
+        columns["last_block"] = aggregateArray(cm.getClusterLastBlocks());
+        return columns;
+    }, "Return a dictionary of numpy arrays indexed by cluster number holding the balance, total received, output count, transaction count, and first and last block of every cluster over every block of the chain when the clustering was generated, including the last blocks left out of the clustering itself. Blocks are -1 for clusters that never appeared in a transaction")
+    ;
+    
+    py::class_<ClusterAggregate>(m, "ClusterAggregate", "Totals of a cluster when the clustering was generated")
+    .def_readonly("balance", &ClusterAggregate::balance, "Value of the unspent outputs sent to the cluster")
+    .def_readonly("total_received", &ClusterAggregate::totalReceived, "Total value sent to the cluster")
+    .def_readonly("output_count", &ClusterAggregate::outputCount, "Number of outputs sent to the cluster")
+    .def_readonly("tx_count", &ClusterAggregate::txCount, "Number of transactions involving the cluster")
+    .def_readonly("first_block", &ClusterAggregate::firstBlock, "Height of the first transaction involving the cluster")
+    .def_readonly("last_block", &ClusterAggregate::lastBlock, "Height of the last transaction involving the cluster")
     ;
     
     py::class_<Cluster>(m, "Cluster", "Class representing a cluster")
@@ -92,6 +119,9 @@ uint64_t totalOutWithoutSelfChurn(const Block &block, ClusterManager &manager) {
     }, "Get a iterable over all the addresses in the cluster")
     .def("tagged_addresses", &Cluster::taggedAddresses, "Given a dictionary of tags, return a list of TaggedAddress objects for any tagged addresses in the cluster")
     .def("count_of_type", &Cluster::countOfType, "Return the number of addresses of the given type in the cluster")
+    .def_property_readonly("aggregate", [](const Cluster &cluster) {
+        return cluster.getAggregate();
+    }, "Return the precomputed totals of this cluster (Much faster than calculating them from its outputs)")
     .def("balance", &Cluster::calculateBalance, py::arg("height") = -1, "Calculates the balance held by this cluster at the height (Defaults to the full chain)")
     .def("outs", &Cluster::getOutputs, "Returns a list of all outputs sent to this cluster")
     .def("ins", &Cluster::getInputs, "Returns a list of all inputs spent from this cluster")
@@ -0,0 +1,115 @@
+//
+//  concurrent_disjoint_sets_stress.cpp
+//  blocksci_cluster
+//
+
+#include <clusterer/concurrent_disjoint_sets.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Many threads unite random pairs in a ConcurrentDisjointSets at once, then the sets are compared with a
+ * sequential union-find given the same pairs. Small element counts make threads fight over the same roots,
+ * large ones build long paths for find to halve while other threads are linking.
+ */
+
+namespace {
+    class SequentialDisjointSets {
+        std::vector<uint32_t> parents;
+
+    public:
+        explicit SequentialDisjointSets(uint32_t size) : parents(size) {
+            for (uint32_t i = 0; i < size; i++) {
+                parents[i] = i;
+            }
+        }
+
+        uint32_t find(uint32_t index) {
+            auto root = index;
+            while (parents[root] != root) {
+                root = parents[root];
+            }
+            while (parents[index] != root) {
+                auto next = parents[index];
+                parents[index] = root;
+                index = next;
+            }
+            return root;
+        }
+
+        void unite(uint32_t a, uint32_t b) {
+            a = find(a);
+            b = find(b);
+            if (a < b) {
+                parents[b] = a;
+            } else if (b < a) {
+                parents[a] = b;
+            }
+        }
+    };
+
+    bool runTrial(uint32_t size, size_t pairCount, unsigned int threadCount, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<uint32_t> dist(0, size - 1);
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        pairs.reserve(pairCount);
+        for (size_t i = 0; i < pairCount; i++) {
+            pairs.emplace_back(dist(rng), dist(rng));
+        }
+
+        ConcurrentDisjointSets concurrent(size);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                // Each thread also calls find on the pairs of other threads so reads race with links
+                for (size_t i = t; i < pairs.size(); i += threadCount) {
+                    concurrent.unite(pairs[i].first, pairs[i].second);
+                    concurrent.find(pairs[(i * 7919) % pairs.size()].first);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        SequentialDisjointSets sequential(size);
+        for (auto &pair : pairs) {
+            sequential.unite(pair.first, pair.second);
+        }
+
+        // Both link the larger root under the smaller, so every root is the smallest element of its set
+        size_t mismatches = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            if (concurrent.find(i) != sequential.find(i)) {
+                mismatches++;
+            }
+        }
+        if (mismatches > 0) {
+            std::cerr << "FAILED " << mismatches << " elements in the wrong set with " << size << " elements, " << pairCount << " pairs, " << threadCount << " threads and seed " << seed << "\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    auto hardwareThreads = std::max(2u, std::thread::hardware_concurrency());
+    bool passed = true;
+    uint32_t seed = 1;
+    for (unsigned int threadCount : {2u, 4u, hardwareThreads, hardwareThreads * 4}) {
+        passed = runTrial(16, 100000, threadCount, seed++) && passed;
+        passed = runTrial(1000, 200000, threadCount, seed++) && passed;
+        passed = runTrial(100000, 1000000, threadCount, seed++) && passed;
+        passed = runTrial(2000000, 1500000, threadCount, seed++) && passed;
+    }
+    if (!passed) {
+        return 1;
+    }
+    std::cout << "Concurrent disjoint sets match the sequential result\n";
+    return 0;
+}
@@ -9,6 +9,7 @@
 #define BLOCKSCI_WITHOUT_SINGLETON
 
 #include "address.hpp"
+#include "address_encoder.hpp"
 #include "dedup_address.hpp"
 #include "equiv_address.hpp"
 #include "address_info.hpp"
@@ -20,8 +21,12 @@
 #include "chain/transaction.hpp"
 #include "chain/output.hpp"
 #include "chain/inout_pointer.hpp"
+#include "chain/chain_access.hpp"
 #include "index/address_index.hpp"
+#include "index/address_prefix_index.hpp"
+#include "index/balance_log.hpp"
 #include "index/hash_index.hpp"
+#include "util/parallel.hpp"
 
 #include <unordered_set>
 #include <iostream>
@@ -102,27 +107,50 @@ namespace blocksci {
         return ranges::nullopt;
     }
     
-    template<AddressType::Enum type>
-    std::vector<Address> getAddressesWithPrefixImp(const std::string &prefix, const DataAccess &access) {
-        std::vector<Address> addresses;
+    // Scans every script of the table's type, keeping the same scripts that AddressPrefixIndex would
+    std::vector<Address> getAddressesWithPrefixImp(size_t table, const std::string &prefix, const DataAccess &access) {
+        constexpr uint32_t batchSize = 4096;
+        auto type = AddressPrefixIndex::indexedTypes[table];
+        AddressEncoder encoder(access.config);
         auto count = access.scripts->scriptCount(dedupType(type));
-        for (uint32_t scriptNum = 1; scriptNum <= count; scriptNum++) {
-            ScriptAddress<type> script(scriptNum, access);
-            if (script.addressString().compare(0, prefix.length(), prefix) == 0) {
-                addresses.push_back(Address(scriptNum, type, access));
+        auto accumulate = [&](std::vector<Address> &addresses, uint64_t chunkBegin, uint64_t chunkEnd) {
+            std::vector<Address> batch;
+            std::vector<AddressString> strings(batchSize);
+            batch.reserve(batchSize);
+            auto scriptNum = chunkBegin;
+            while (scriptNum < chunkEnd) {
+                batch.clear();
+                for (; scriptNum < chunkEnd && batch.size() < batchSize; scriptNum++) {
+                    if (AddressPrefixIndex::hasString(table, static_cast<uint32_t>(scriptNum), *access.scripts)) {
+                        batch.emplace_back(static_cast<uint32_t>(scriptNum), type, access);
+                    }
+                }
+                encoder.encode(batch.data(), batch.size(), strings.data());
+                for (size_t i = 0; i < batch.size(); i++) {
+                    if (strings[i].startsWith(prefix)) {
+                        addresses.push_back(batch[i]);
+                    }
+                }
             }
-        }
-        return addresses;
+        };
+        auto combine = [](std::vector<Address> &addresses, std::vector<Address> &chunkAddresses) {
+            addresses.insert(addresses.end(), chunkAddresses.begin(), chunkAddresses.end());
+        };
+        return parallelReduceChunks(getThreadPool(access.config.threadCount), 1, uint64_t{count} + 1, std::vector<Address>{}, accumulate, combine);
     }
     
     std::vector<Address> getAddressesWithPrefix(const std::string &prefix, const DataAccess &access) {
-        if (prefix.compare(0, 1, "1") == 0) {
-            return getAddressesWithPrefixImp<AddressType::Enum::PUBKEYHASH>(prefix, access);
-        } else if (prefix.compare(0, 1, "3") == 0) {
-            return getAddressesWithPrefixImp<AddressType::Enum::SCRIPTHASH>(prefix, access);
-        } else {
-            return {};
+        if (access.prefixIndex->isBuilt()) {
+            return access.prefixIndex->lookup(prefix, access);
+        }
+        std::vector<Address> addresses;
+        for (size_t i = 0; i < AddressPrefixIndex::tableCount; i++) {
+            if (AddressPrefixIndex::prefixMayMatch(access.config, i, prefix)) {
+                auto tableAddresses = getAddressesWithPrefixImp(i, prefix, access);
+                addresses.insert(addresses.end(), tableAddresses.begin(), tableAddresses.end());
+            }
         }
+        return addresses;
     }
     
     std::string fullTypeImp(const Address &address, const DataAccess &access) {
@@ -157,10 +185,31 @@ namespace blocksci {
         return EquivAddress{*this, nestedEquivalent};
     }
     
+    bool balanceLogCovers(BlockHeight height, const DataAccess &access) {
+        auto &log = *access.balanceLog;
+        if (!log.isBuilt()) {
+            return false;
+        }
+        if (height == -1) {
+            return log.blockCount() >= access.chain->blockCount();
+        }
+        return height < log.blockCount();
+    }
+    
     uint64_t Address::calculateBalance(BlockHeight height) const {
+        if (balanceLogCovers(height, *access)) {
+            return access->balanceLog->balance(*this, height == -1 ? access->chain->blockCount() - 1 : height);
+        }
         return blocksci::calculateBalance(getOutputPointers(), height, *access);
     }
     
+    std::vector<BalanceChange> Address::balanceHistory() const {
+        if (balanceLogCovers(-1, *access)) {
+            return access->balanceLog->history(*this);
+        }
+        return blocksci::balanceHistory(getOutputPointers(), *access);
+    }
+    
     std::vector<OutputPointer> Address::getOutputPointers() const {
         return access->addressIndex->getOutputPointers(*this);
     }
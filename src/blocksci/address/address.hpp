@@ -64,6 +64,7 @@ namespace blocksci {
         AnyScript getScript() const;
         
         uint64_t calculateBalance(BlockHeight height) const;
+        std::vector<BalanceChange> balanceHistory() const;
         
         EquivAddress getEquivAddresses(bool nestedEquivalent) const;
         
@@ -82,7 +83,11 @@ namespace blocksci {
     
     ranges::optional<Address> getAddressFromString(const std::string &addressString, const DataAccess &access);
     
+    // Same results with or without the address prefix index, see AddressPrefixIndex::hasString for script hashes
     std::vector<Address> getAddressesWithPrefix(const std::string &prefix, const DataAccess &access);
+    
+    // Whether the balance log holds every change up to the height, with -1 meaning the whole chain
+    bool balanceLogCovers(BlockHeight height, const DataAccess &access);
 
     inline RawAddress::RawAddress(const Address &address) : scriptNum(address.scriptNum), type(address.type) {}
 }
@@ -0,0 +1,297 @@
+//
+//  address_encoder.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "address_encoder.hpp"
+#include "scripts/script_access.hpp"
+#include "scripts/script_data.hpp"
+#include "util/data_access.hpp"
+#include "util/data_configuration.hpp"
+#include "util/hash.hpp"
+#include "util/parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        const char *base58Chars = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+        const char *bech32Chars = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+        // 58^5 is the largest power of 58 below 2^32
+        constexpr uint64_t base58Chunk = 656356768;
+        constexpr int base58ChunkDigits = 5;
+
+        constexpr size_t checksumLength = 4;
+        constexpr size_t maxBase58Payload = 32;
+
+        size_t encodeBase58(const unsigned char *data, size_t size, char *out) {
+            size_t zeroes = 0;
+            while (zeroes < size && data[zeroes] == 0) {
+                zeroes++;
+            }
+
+            // Big endian 32 bit limbs, with the most significant limb padded on the left
+            uint32_t limbs[maxBase58Payload / 4];
+            size_t limbCount = (size + 3) / 4;
+            memset(limbs, 0, sizeof(limbs));
+            size_t padding = limbCount * 4 - size;
+            for (size_t i = 0; i < size; i++) {
+                size_t pos = i + padding;
+                limbs[pos / 4] |= static_cast<uint32_t>(data[i]) << (8 * (3 - pos % 4));
+            }
+
+            // Digits are produced least significant first, five at a time
+            uint8_t digits[64];
+            size_t digitCount = 0;
+            size_t firstLimb = 0;
+            while (firstLimb < limbCount && limbs[firstLimb] == 0) {
+                firstLimb++;
+            }
+            while (firstLimb < limbCount) {
+                uint64_t remainder = 0;
+                for (size_t i = firstLimb; i < limbCount; i++) {
+                    uint64_t current = (remainder << 32) | limbs[i];
+                    limbs[i] = static_cast<uint32_t>(current / base58Chunk);
+                    remainder = current % base58Chunk;
+                }
+                while (firstLimb < limbCount && limbs[firstLimb] == 0) {
+                    firstLimb++;
+                }
+                for (int i = 0; i < base58ChunkDigits; i++) {
+                    digits[digitCount++] = static_cast<uint8_t>(remainder % 58);
+                    remainder /= 58;
+                }
+            }
+            while (digitCount > 0 && digits[digitCount - 1] == 0) {
+                digitCount--;
+            }
+
+            size_t length = 0;
+            for (size_t i = 0; i < zeroes; i++) {
+                out[length++] = '1';
+            }
+            while (digitCount > 0) {
+                out[length++] = base58Chars[digits[--digitCount]];
+            }
+            return length;
+        }
+
+        uint32_t bech32PolymodStep(uint32_t chk, uint8_t value) {
+            uint8_t top = chk >> 25;
+            return ((chk & 0x1ffffff) << 5) ^ value ^
+                (-((top >> 0) & 1) & 0x3b6a57b2UL) ^
+                (-((top >> 1) & 1) & 0x26508e6dUL) ^
+                (-((top >> 2) & 1) & 0x1ea119faUL) ^
+                (-((top >> 3) & 1) & 0x3d4233ddUL) ^
+                (-((top >> 4) & 1) & 0x2a1462b3UL);
+        }
+
+        void copyPrefix(const std::vector<unsigned char> &prefix, unsigned char *dest, size_t &length, size_t maxLength) {
+            if (prefix.size() > maxLength) {
+                throw std::runtime_error("Address version prefix is too long");
+            }
+            std::copy(prefix.begin(), prefix.end(), dest);
+            length = prefix.size();
+        }
+
+        // An address waiting for its base58 checksum
+        struct Base58Payload {
+            unsigned char bytes[maxBase58Payload];
+            size_t length;
+            AddressString *out;
+        };
+    }
+
+    AddressEncoder::AddressEncoder(const DataConfiguration &config) : segwitPrefix(config.segwitPrefix) {
+        copyPrefix(config.pubkeyPrefix, pubkeyPrefix, pubkeyPrefixLength, maxPrefixLength);
+        copyPrefix(config.scriptPrefix, scriptPrefix, scriptPrefixLength, maxPrefixLength);
+
+        // Longest witness program is 32 bytes, which is 1 version + 52 data + 6 checksum characters after the separator
+        if (segwitPrefix.size() + 1 + 1 + 52 + 6 > AddressString::maxLength) {
+            throw std::runtime_error("Segwit address prefix is too long");
+        }
+
+        // The checksum always starts with the expanded human readable part, so its state is computed once
+        uint32_t chk = 1;
+        for (auto c : segwitPrefix) {
+            chk = bech32PolymodStep(chk, static_cast<uint8_t>(static_cast<unsigned char>(c) >> 5));
+        }
+        chk = bech32PolymodStep(chk, 0);
+        for (auto c : segwitPrefix) {
+            chk = bech32PolymodStep(chk, static_cast<uint8_t>(static_cast<unsigned char>(c) & 0x1f));
+        }
+        segwitPrefixChecksum = chk;
+    }
+
+    void AddressEncoder::encodeWitness(const unsigned char *program, size_t programLength, AddressString &out) const {
+        size_t length = 0;
+        for (auto c : segwitPrefix) {
+            out.chars[length++] = c;
+        }
+        out.chars[length++] = '1';
+
+        uint32_t chk = segwitPrefixChecksum;
+        auto addValue = [&](uint8_t value) {
+            chk = bech32PolymodStep(chk, value);
+            out.chars[length++] = bech32Chars[value];
+        };
+
+        // Witness version 0 followed by the program regrouped from 8 to 5 bits
+        addValue(0);
+        uint32_t acc = 0;
+        int bits = 0;
+        for (size_t i = 0; i < programLength; i++) {
+            acc = ((acc << 8) | program[i]) & 0xfff;
+            bits += 8;
+            while (bits >= 5) {
+                bits -= 5;
+                addValue((acc >> bits) & 31);
+            }
+        }
+        if (bits) {
+            addValue((acc << (5 - bits)) & 31);
+        }
+
+        for (int i = 0; i < 6; i++) {
+            chk = bech32PolymodStep(chk, 0);
+        }
+        chk ^= 1;
+        for (int i = 0; i < 6; i++) {
+            out.chars[length++] = bech32Chars[(chk >> (5 * (5 - i))) & 31];
+        }
+        out.length = static_cast<uint8_t>(length);
+    }
+
+    void AddressEncoder::encode(const AddressType::Enum *types, const uint256 *hashes, size_t count, AddressString *out) const {
+        constexpr size_t batchSize = 64;
+        Base58Payload payloads[batchSize];
+        const unsigned char *messages[batchSize];
+        size_t lengths[batchSize];
+        uint256 checksums[batchSize];
+        size_t pending = 0;
+
+        auto finishBatch = [&]() {
+            doubleSha256Batch(messages, lengths, checksums, pending);
+            for (size_t i = 0; i < pending; i++) {
+                auto &payload = payloads[i];
+                memcpy(payload.bytes + payload.length, checksums[i].begin(), checksumLength);
+                payload.out->length = static_cast<uint8_t>(encodeBase58(payload.bytes, payload.length + checksumLength, payload.out->chars));
+            }
+            pending = 0;
+        };
+
+        auto addBase58 = [&](const unsigned char *prefix, size_t prefixLength, const uint256 &hash, AddressString &dest) {
+            auto &payload = payloads[pending];
+            memcpy(payload.bytes, prefix, prefixLength);
+            memcpy(payload.bytes + prefixLength, hash.begin(), sizeof(uint160));
+            payload.length = prefixLength + sizeof(uint160);
+            payload.out = &dest;
+            messages[pending] = payload.bytes;
+            lengths[pending] = payload.length;
+            pending++;
+            if (pending == batchSize) {
+                finishBatch();
+            }
+        };
+
+        for (size_t i = 0; i < count; i++) {
+            auto &dest = out[i];
+            dest.length = 0;
+            switch (types[i]) {
+                case AddressType::Enum::PUBKEY:
+                case AddressType::Enum::PUBKEYHASH:
+                case AddressType::Enum::MULTISIG_PUBKEY: {
+                    addBase58(pubkeyPrefix, pubkeyPrefixLength, hashes[i], dest);
+                    break;
+                }
+                case AddressType::Enum::SCRIPTHASH: {
+                    addBase58(scriptPrefix, scriptPrefixLength, hashes[i], dest);
+                    break;
+                }
+                case AddressType::Enum::WITNESS_PUBKEYHASH: {
+                    encodeWitness(hashes[i].begin(), sizeof(uint160), dest);
+                    break;
+                }
+                case AddressType::Enum::WITNESS_SCRIPTHASH: {
+                    encodeWitness(hashes[i].begin(), sizeof(uint256), dest);
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+        }
+        if (pending > 0) {
+            finishBatch();
+        }
+    }
+
+    void AddressEncoder::encode(const Address *addresses, size_t count, AddressString *out) const {
+        constexpr size_t chunkSize = 256;
+        AddressType::Enum types[chunkSize];
+        uint256 hashes[chunkSize];
+        auto setHash160 = [](uint256 &hash, const uint160 &hash160) {
+            memcpy(hash.begin(), hash160.begin(), sizeof(hash160));
+        };
+
+        for (size_t chunkBegin = 0; chunkBegin < count; chunkBegin += chunkSize) {
+            auto chunkCount = std::min(chunkSize, count - chunkBegin);
+            for (size_t i = 0; i < chunkCount; i++) {
+                auto &address = addresses[chunkBegin + i];
+                if (address.scriptNum == 0) {
+                    types[i] = AddressType::Enum::NONSTANDARD;
+                    continue;
+                }
+                types[i] = address.type;
+                auto &scripts = *address.getAccess().scripts;
+                switch (address.type) {
+                    case AddressType::Enum::PUBKEY:
+                    case AddressType::Enum::PUBKEYHASH:
+                    case AddressType::Enum::MULTISIG_PUBKEY:
+                    case AddressType::Enum::WITNESS_PUBKEYHASH: {
+                        setHash160(hashes[i], scripts.getScriptData<DedupAddressType::PUBKEY>(address.scriptNum)->address);
+                        break;
+                    }
+                    case AddressType::Enum::SCRIPTHASH: {
+                        setHash160(hashes[i], scripts.getScriptData<DedupAddressType::SCRIPTHASH>(address.scriptNum)->getHash160());
+                        break;
+                    }
+                    case AddressType::Enum::WITNESS_SCRIPTHASH: {
+                        hashes[i] = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(address.scriptNum)->hash256;
+                        break;
+                    }
+                    default: {
+                        break;
+                    }
+                }
+            }
+            encode(types, hashes, chunkCount, out + chunkBegin);
+        }
+    }
+
+    void encodeAddresses(const Address *addresses, size_t count, AddressString *out) {
+        if (count == 0) {
+            return;
+        }
+        AddressEncoder encoder(addresses[0].getAccess().config);
+        encoder.encode(addresses, count, out);
+    }
+
+    std::vector<AddressString> encodeAddresses(const std::vector<Address> &addresses) {
+        std::vector<AddressString> strings(addresses.size());
+        if (addresses.empty()) {
+            return strings;
+        }
+        auto &config = addresses[0].getAccess().config;
+        AddressEncoder encoder(config);
+        parallelForChunks(getThreadPool(config.threadCount), 0, addresses.size(), [&](uint64_t chunkBegin, uint64_t chunkEnd) {
+            encoder.encode(addresses.data() + chunkBegin, chunkEnd - chunkBegin, strings.data() + chunkBegin);
+        });
+        return strings;
+    }
+}
@@ -0,0 +1,72 @@
+//
+//  address_encoder.hpp
+//  blocksci
+//
+
+#ifndef address_encoder_hpp
+#define address_encoder_hpp
+
+#include "address.hpp"
+
+#include <blocksci/util/bitcoin_uint256.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    struct DataConfiguration;
+
+    // Fixed size buffer holding the string form of an address. Large enough for any bech32 string
+    struct AddressString {
+        static constexpr size_t maxLength = 90;
+
+        char chars[maxLength];
+        uint8_t length = 0;
+
+        bool empty() const {
+            return length == 0;
+        }
+
+        bool startsWith(const std::string &prefix) const {
+            return prefix.size() <= length && prefix.compare(0, prefix.size(), chars, prefix.size()) == 0;
+        }
+
+        std::string str() const {
+            return std::string(chars, length);
+        }
+    };
+
+    /* Encodes addresses to their base58 or bech32 string form without allocating per address. Base58
+     * checksums are hashed together in batches, base58 conversion divides by a power of 58 in 32 bit limbs
+     * rather than byte by byte, and the bech32 checksum state for the human readable part is computed once.
+     */
+    class AddressEncoder {
+        static constexpr size_t maxPrefixLength = 8;
+
+        unsigned char pubkeyPrefix[maxPrefixLength];
+        size_t pubkeyPrefixLength;
+        unsigned char scriptPrefix[maxPrefixLength];
+        size_t scriptPrefixLength;
+        std::string segwitPrefix;
+        uint32_t segwitPrefixChecksum;
+
+        void encodeWitness(const unsigned char *program, size_t programLength, AddressString &out) const;
+
+    public:
+        explicit AddressEncoder(const DataConfiguration &config);
+
+        // Addresses without a string form (multisig, nulldata and nonstandard) are left empty
+        void encode(const Address *addresses, size_t count, AddressString *out) const;
+
+        // Encodes addresses given by type and the hash in their script data. Witness script hashes use all 32
+        // bytes of the hash and the other types its first 20
+        void encode(const AddressType::Enum *types, const uint256 *hashes, size_t count, AddressString *out) const;
+    };
+
+    void encodeAddresses(const Address *addresses, size_t count, AddressString *out);
+    std::vector<AddressString> encodeAddresses(const std::vector<Address> &addresses);
+}
+
+#endif /* address_encoder_hpp */
@@ -11,41 +11,60 @@
 #include <blocksci/util/data_access.hpp>
 #include <blocksci/util/hash.hpp>
 #include <blocksci/index/address_index.hpp>
+#include <blocksci/index/balance_log.hpp>
+#include <blocksci/chain/chain_access.hpp>
 #include <blocksci/chain/inout_pointer.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 
+#include <algorithm>
+#include <sstream>
+
 using namespace blocksci;
 
 namespace std
 {
     size_t hash<blocksci::EquivAddress>::operator()(const blocksci::EquivAddress &equiv) const {
         std::size_t seed = 123954;
-        for (const auto &address : equiv.addresses) {
+        for (auto address : equiv) {
             seed ^= address.scriptNum + address.type;
         }
         return seed;
     }
 }
 
-EquivAddress::EquivAddress(uint32_t scriptNum, EquivAddressType::Enum type, bool scriptEquivalent_, const DataAccess &access_) : scriptEquivalent(scriptEquivalent_), access(access_) {
-    for (auto type : equivAddressTypes(type)) {
+EquivAddress::EquivAddress(uint32_t scriptNum_, EquivAddressType::Enum equivType_, bool scriptEquivalent_, const DataAccess &access_) : scriptNum(scriptNum_), typeMask(0), scriptEquivalent(scriptEquivalent_), access(access_) {
+    for (size_t i = 0; i < AddressType::size; i++) {
+        auto type = static_cast<AddressType::Enum>(i);
+        if (equivType(type) != equivType_) {
+            continue;
+        }
         Address address(scriptNum, type, access);
         if (scriptEquivalent) {
             auto nested = access.addressIndex->getPossibleNestedEquivalent(address);
             for (auto &nestedAddress : nested) {
                 if (access.addressIndex->checkIfExists(nestedAddress)) {
-                    addresses.insert(nestedAddress);
+                    if (nestedAddress.scriptNum == scriptNum && equivType(nestedAddress.type) == equivType_) {
+                        typeMask |= static_cast<uint16_t>(1u << nestedAddress.type);
+                    } else {
+                        nestedAddresses.push_back(nestedAddress);
+                    }
                 }
             }
         } else {
             if (access.addressIndex->checkIfExists(address)) {
-                addresses.insert(address);
+                typeMask |= static_cast<uint16_t>(1u << type);
             }
         }
-        
+    }
+    if (!nestedAddresses.empty()) {
+        auto addressLess = [](const Address &a, const Address &b) {
+            return std::make_pair(a.type, a.scriptNum) < std::make_pair(b.type, b.scriptNum);
+        };
+        std::sort(nestedAddresses.begin(), nestedAddresses.end(), addressLess);
+        nestedAddresses.erase(std::unique(nestedAddresses.begin(), nestedAddresses.end()), nestedAddresses.end());
     }
 }
 
@@ -59,9 +78,10 @@ std::string EquivAddress::toString() const {
     std::stringstream ss;
     ss << "EquivAddress(";
     size_t i = 0;
-    for (auto &address : addresses) {
+    auto count = size();
+    for (auto address : *this) {
         ss << address.getScript().toString();
-        if (i < addresses.size() - 1) {
+        if (i < count - 1) {
             ss << ", ";
         }
         i++;
@@ -72,7 +92,7 @@ std::string EquivAddress::toString() const {
 
 std::vector<OutputPointer> EquivAddress::getOutputPointers() const {
     std::vector<OutputPointer> outputs;
-    for (const auto &address : addresses) {
+    for (auto address : *this) {
         auto addrOuts = access.addressIndex->getOutputPointers(address);
         outputs.insert(outputs.end(), addrOuts.begin(), addrOuts.end());
     }
@@ -80,9 +100,33 @@ std::vector<OutputPointer> EquivAddress::getOutputPointers() const {
 }
 
 uint64_t EquivAddress::calculateBalance(BlockHeight height) const {
+    if (balanceLogCovers(height, access)) {
+        auto logHeight = height == -1 ? access.chain->blockCount() - 1 : height;
+        uint64_t value = 0;
+        for (auto address : *this) {
+            value += access.balanceLog->balance(address, logHeight);
+        }
+        return value;
+    }
     return blocksci::calculateBalance(getOutputPointers(), height, access);
 }
 
+std::vector<BalanceChange> EquivAddress::balanceHistory() const {
+    if (balanceLogCovers(-1, access)) {
+        std::vector<std::pair<BlockHeight, int64_t>> changes;
+        for (auto address : *this) {
+            uint64_t previous = 0;
+            auto run = access.balanceLog->changes(address);
+            for (auto it = run.first; it != run.second; ++it) {
+                changes.emplace_back(it->height, static_cast<int64_t>(it->balance - previous));
+                previous = it->balance;
+            }
+        }
+        return blocksci::balanceHistory(std::move(changes));
+    }
+    return blocksci::balanceHistory(getOutputPointers(), access);
+}
+
 std::vector<Output> EquivAddress::getOutputs() const {
     return blocksci::getOutputs(getOutputPointers(), access);
 }
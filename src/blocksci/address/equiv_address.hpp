@@ -11,45 +11,106 @@
 #include <blocksci/blocksci_fwd.hpp>
 #include <blocksci/address/address.hpp>
 
-#include <unordered_set>
+#include <cstdint>
+#include <iterator>
+#include <vector>
 
 namespace blocksci {
+    /* The addresses of one equivalence class. Equivalent types of the same script share its script number, so they
+     * are held as a bitmask of address types and addresses are produced while iterating. Nested equivalents found
+     * through the address index have other script numbers and are the only ones stored individually, which keeps
+     * construction allocation free unless scriptEquivalent is set.
+     */
     class EquivAddress {
-        std::unordered_set<Address> addresses;
+        uint32_t scriptNum;
+        uint16_t typeMask;
+        static_assert(AddressType::size <= 16, "typeMask needs a bit for every address type");
         bool scriptEquivalent;
+        // Sorted by type and script number
+        std::vector<Address> nestedAddresses;
         const DataAccess &access;
         
-        friend struct std::hash<EquivAddress>;
-        
         EquivAddress(uint32_t scriptNum, EquivAddressType::Enum type, bool scriptEquivalent_, const DataAccess &access_);
     public:
+        class const_iterator {
+            const EquivAddress *equiv;
+            uint16_t remainingMask;
+            size_t nestedIndex;
+            
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Address;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Address;
+            
+            const_iterator() : equiv(nullptr), remainingMask(0), nestedIndex(0) {}
+            const_iterator(const EquivAddress *equiv_, uint16_t remainingMask_, size_t nestedIndex_) : equiv(equiv_), remainingMask(remainingMask_), nestedIndex(nestedIndex_) {}
+            
+            Address operator*() const {
+                if (remainingMask != 0) {
+                    auto type = static_cast<AddressType::Enum>(__builtin_ctz(remainingMask));
+                    return Address{equiv->scriptNum, type, equiv->access};
+                }
+                return equiv->nestedAddresses[nestedIndex];
+            }
+            
+            const_iterator &operator++() {
+                if (remainingMask != 0) {
+                    remainingMask &= static_cast<uint16_t>(remainingMask - 1);
+                } else {
+                    nestedIndex++;
+                }
+                return *this;
+            }
+            
+            const_iterator operator++(int) {
+                auto it = *this;
+                ++*this;
+                return it;
+            }
+            
+            bool operator==(const const_iterator &other) const {
+                return remainingMask == other.remainingMask && nestedIndex == other.nestedIndex;
+            }
+            
+            bool operator!=(const const_iterator &other) const {
+                return !operator==(other);
+            }
+        };
+        
         EquivAddress(const Address &address, bool scriptEquivalent);
         EquivAddress(const DedupAddress &address, bool scriptEquivalent, const DataAccess &access);
         
         bool operator==(const EquivAddress &other) const {
-            if (scriptEquivalent != other.scriptEquivalent) {
+            if (scriptEquivalent != other.scriptEquivalent || typeMask != other.typeMask) {
+                return false;
+            }
+            // The script number only identifies addresses when some of its types are present
+            if (typeMask != 0 && scriptNum != other.scriptNum) {
                 return false;
             }
-            return addresses == other.addresses;
+            return nestedAddresses == other.nestedAddresses;
         }
         
         std::string toString() const;
         
         size_t size() const {
-            return addresses.size();
+            return static_cast<size_t>(__builtin_popcount(typeMask)) + nestedAddresses.size();
         }
         
-        std::unordered_set<Address>::const_iterator begin() const {
-            return addresses.begin();
+        const_iterator begin() const {
+            return {this, typeMask, 0};
         }
         
-        std::unordered_set<Address>::const_iterator end() const {
-            return addresses.end();
+        const_iterator end() const {
+            return {this, 0, nestedAddresses.size()};
         }
         
         std::vector<OutputPointer> getOutputPointers() const;
         
         uint64_t calculateBalance(BlockHeight height) const;
+        std::vector<BalanceChange> balanceHistory() const;
         std::vector<Output> getOutputs() const;
         std::vector<Input> getInputs() const;
         std::vector<Transaction> getTransactions() const;
@@ -9,6 +9,8 @@
 #define chain_algorithms_hpp
 
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/chain_access.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/address/address_info.hpp>
 #include <blocksci/scripts/script_info.hpp>
@@ -18,6 +20,9 @@
 #include <range/v3/view/remove_if.hpp>
 #include <range/v3/view/filter.hpp>
 #include <range/v3/numeric/accumulate.hpp>
+#include <range/v3/range_for.hpp>
+
+#include <vector>
 
 namespace blocksci {
     
@@ -43,6 +48,131 @@ namespace blocksci {
     struct fail_helper : std::false_type
     { };
     
+    template <typename T, bool = ranges::Range<T>()>
+    struct hasRawTxesImp : std::integral_constant<bool, isTx<std::decay_t<T>>> {};
+    
+    template <typename T>
+    struct hasRawTxesImp<T, true> : std::integral_constant<bool, isTxRange<T> || isBlockRange<T>> {};
+    
+    // Transactions, blocks and ranges of either can be aggregated by scanning the raw transaction data
+    template <typename T>
+    constexpr bool hasRawTxes = hasRawTxesImp<T>::value;
+    
+    namespace detail {
+        // Transactions are stored back to back, so consecutive tx numbers are walked without going through the tx index
+        template <typename Func>
+        inline void forEachRawTxInRange(const ChainAccess &chain, uint32_t firstTx, uint32_t endTx, Func &func) {
+            if (firstTx >= endTx) {
+                return;
+            }
+            auto pos = reinterpret_cast<const char *>(chain.getTx(firstTx));
+            for (uint32_t txNum = firstTx; txNum < endTx; txNum++) {
+                auto tx = reinterpret_cast<const RawTransaction *>(pos);
+                func(*tx, chain);
+                pos += tx->serializedSize();
+            }
+        }
+    }
+    
+    namespace detail {
+        // Stats recorded by the parser when t is a single block, otherwise nullptr
+        template <typename T>
+        inline const RawBlockStats *recordedBlockStats(const T &) {
+            return nullptr;
+        }
+        
+        inline const RawBlockStats *recordedBlockStats(const Block &block) {
+            return block.getAccess().chain->getBlockStats(block.height());
+        }
+    }
+    
+    namespace detail {
+        // Merges consecutive transaction numbers into runs and calls func(const ChainAccess &, firstTx, endTx) for each
+        template <typename Func>
+        class TxRunBuilder {
+            Func &func;
+            const ChainAccess *chain = nullptr;
+            uint32_t runStart = 0;
+            uint32_t runEnd = 0;
+            
+        public:
+            explicit TxRunBuilder(Func &func_) : func(func_) {}
+            
+            void add(const ChainAccess &txChain, uint32_t firstTx, uint32_t endTx) {
+                if (chain == &txChain && firstTx == runEnd) {
+                    runEnd = endTx;
+                    return;
+                }
+                finish();
+                chain = &txChain;
+                runStart = firstTx;
+                runEnd = endTx;
+            }
+            
+            void finish() {
+                if (chain != nullptr && runStart < runEnd) {
+                    func(*chain, runStart, runEnd);
+                }
+                chain = nullptr;
+            }
+        };
+    }
+    
+    // Calls func(const ChainAccess &, uint32_t firstTx, uint32_t endTx) for runs of consecutive transactions covering t
+    template <typename Func>
+    inline void forEachTxRun(const Transaction &tx, Func &&func) {
+        func(*tx.getAccess().chain, tx.txNum, tx.txNum + 1);
+    }
+    
+    template <typename Func>
+    inline void forEachTxRun(const Block &block, Func &&func) {
+        func(*block.getAccess().chain, block.firstTxIndex(), block.endTxIndex());
+    }
+    
+    template <typename B, typename Func, CONCEPT_REQUIRES_(ranges::Range<B>()), std::enable_if_t<isBlockRange<B>, int> = 0>
+    inline void forEachTxRun(B && b, Func &&func) {
+        // Runs of adjacent blocks are merged so that a whole chain is a single pass
+        detail::TxRunBuilder<Func> runs(func);
+        RANGES_FOR(auto block, b) {
+            runs.add(*block.getAccess().chain, block.firstTxIndex(), block.endTxIndex());
+        }
+        runs.finish();
+    }
+    
+    template <typename B, typename Func, CONCEPT_REQUIRES_(ranges::Range<B>()), std::enable_if_t<isTxRange<B> && !std::is_same<std::decay_t<B>, Block>::value, int> = 0>
+    inline void forEachTxRun(B && b, Func &&func) {
+        detail::TxRunBuilder<Func> runs(func);
+        RANGES_FOR(auto tx, b) {
+            runs.add(*tx.getAccess().chain, tx.txNum, tx.txNum + 1);
+        }
+        runs.finish();
+    }
+    
+    // Calls func(const RawTransaction &, const ChainAccess &) for every transaction in t
+    template <typename Func>
+    inline void forEachRawTx(const Transaction &tx, Func &&func) {
+        func(tx.rawTx(), *tx.getAccess().chain);
+    }
+    
+    template <typename Func>
+    inline void forEachRawTx(const Block &block, Func &&func) {
+        detail::forEachRawTxInRange(*block.getAccess().chain, block.firstTxIndex(), block.endTxIndex(), func);
+    }
+    
+    template <typename B, typename Func, CONCEPT_REQUIRES_(ranges::Range<B>()), std::enable_if_t<isBlockRange<B>, int> = 0>
+    inline void forEachRawTx(B && b, Func &&func) {
+        forEachTxRun(std::forward<B>(b), [&](const ChainAccess &chain, uint32_t firstTx, uint32_t endTx) {
+            detail::forEachRawTxInRange(chain, firstTx, endTx, func);
+        });
+    }
+    
+    template <typename B, typename Func, CONCEPT_REQUIRES_(ranges::Range<B>()), std::enable_if_t<isTxRange<B> && !std::is_same<std::decay_t<B>, Block>::value, int> = 0>
+    inline void forEachRawTx(B && b, Func &&func) {
+        RANGES_FOR(auto tx, b) {
+            func(tx.rawTx(), *tx.getAccess().chain);
+        }
+    }
+    
     template <typename B, CONCEPT_REQUIRES_(ranges::Range<B>()), std::enable_if_t<isTxRange<B>, int> = 0>
     inline auto txes(B && b) {
         return std::forward<B>(b);
@@ -162,43 +292,185 @@ namespace blocksci {
         return inputs(std::forward<T>(t)) | ranges::view::filter([=](const Input &input) { return dedupType(input.getType()) == type; });
     }
     
-    template <typename T>
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
     inline uint64_t inputCount(T && t) {
-        auto values = txes(std::forward<T>(t)) | ranges::view::transform([](const Transaction &tx) { return tx.inputCount(); });
-        return ranges::accumulate(values, uint64_t{0});
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->inputCount;
+        }
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &) {
+            total += tx.inputCount;
+        });
+        return total;
     }
     
-    template <typename T>
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
     inline uint64_t outputCount(T && t) {
-        auto values = txes(std::forward<T>(t)) | ranges::view::transform([](const Transaction &tx) { return tx.outputCount(); });
-        return ranges::accumulate(values, uint64_t{0});
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->outputCount;
+        }
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &) {
+            total += tx.outputCount;
+        });
+        return total;
     }
     
-    template <typename T>
+    inline uint64_t inputValue(const RawTransaction &tx) {
+        uint64_t total = 0;
+        for (uint16_t i = 0; i < tx.inputCount; i++) {
+            total += tx.getInput(i).getValue();
+        }
+        return total;
+    }
+    
+    inline uint64_t outputValue(const RawTransaction &tx) {
+        uint64_t total = 0;
+        for (uint16_t i = 0; i < tx.outputCount; i++) {
+            total += tx.getOutput(i).getValue();
+        }
+        return total;
+    }
+    
+    inline uint64_t fee(const RawTransaction &tx) {
+        if (tx.inputCount == 0) {
+            return 0;
+        }
+        return inputValue(tx) - outputValue(tx);
+    }
+    
+    namespace detail {
+        using TxColumn = const uint64_t *(ChainAccess::*)(uint32_t) const;
+        
+        // Start of the column for [firstTx, endTx), or nullptr if the parser hasn't recorded all of it
+        inline const uint64_t *txColumnRun(const ChainAccess &chain, TxColumn column, uint32_t firstTx, uint32_t endTx) {
+            return (chain.*column)(endTx - 1) != nullptr ? (chain.*column)(firstTx) : nullptr;
+        }
+        
+        // Calls func(value) with the column value of every transaction in t, falling back to rawValue(tx)
+        template <typename T, typename RawFunc, typename Func>
+        inline void forEachTxColumnValue(T && t, TxColumn column, RawFunc rawValue, Func &&func) {
+            forEachTxRun(std::forward<T>(t), [&](const ChainAccess &chain, uint32_t firstTx, uint32_t endTx) {
+                if (auto values = txColumnRun(chain, column, firstTx, endTx)) {
+                    for (uint32_t i = 0; i < endTx - firstTx; i++) {
+                        func(values[i]);
+                    }
+                } else {
+                    auto rawFunc = [&](const RawTransaction &tx, const ChainAccess &) {
+                        func(rawValue(tx));
+                    };
+                    forEachRawTxInRange(chain, firstTx, endTx, rawFunc);
+                }
+            });
+        }
+        
+        template <typename T, typename RawFunc>
+        inline uint64_t sumTxColumn(T && t, TxColumn column, RawFunc rawValue) {
+            uint64_t total = 0;
+            forEachTxColumnValue(std::forward<T>(t), column, rawValue, [&](uint64_t value) {
+                total += value;
+            });
+            return total;
+        }
+    }
+    
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t totalInputValue(T && t) {
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->inputValue;
+        }
+        return detail::sumTxColumn(std::forward<T>(t), &ChainAccess::getTxInputValues, [](const RawTransaction &tx) {
+            return inputValue(tx);
+        });
+    }
+    
+    template <typename T, std::enable_if_t<!hasRawTxes<T>, int> = 0>
     inline uint64_t totalInputValue(T && t) {
         auto values = inputs(std::forward<T>(t)) | ranges::view::transform([](const Input &a) { return a.getValue(); });
         return ranges::accumulate(values, uint64_t{0});
     }
     
-    template <typename T>
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t totalOutputValue(T && t) {
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->outputValue;
+        }
+        return detail::sumTxColumn(std::forward<T>(t), &ChainAccess::getTxOutputValues, [](const RawTransaction &tx) {
+            return outputValue(tx);
+        });
+    }
+    
+    template <typename T, std::enable_if_t<!hasRawTxes<T>, int> = 0>
     inline uint64_t totalOutputValue(T && t) {
         auto values = outputs(std::forward<T>(t)) | ranges::view::transform([](const Output &a) { return a.getValue(); });
         return ranges::accumulate(values, uint64_t{0});
     }
     
-    inline uint64_t fee(const Transaction &tx) {
-        if (tx.isCoinbase()) {
-            return 0;
-        } else {
-            uint64_t total = 0;
-            for (auto &input : tx.rawInputs()) {
-                total += input.getValue();
+    // Same as Output::isSpent, without constructing the Output
+    inline bool isSpentRaw(const Inout &output, const ChainAccess &chain) {
+        return output.linkedTxNum != 0 && output.linkedTxNum < chain.maxLoadedTx();
+    }
+    
+    // Equivalent to ranges::distance(outputsUnspent(t))
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t unspentOutputCount(T && t) {
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &chain) {
+            for (uint16_t i = 0; i < tx.outputCount; i++) {
+                total += !isSpentRaw(tx.getOutput(i), chain);
             }
-            for (auto &output : tx.rawOutputs()) {
-                total -= output.getValue();
+        });
+        return total;
+    }
+    
+    // Equivalent to totalOutputValue(outputsUnspent(t))
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t unspentOutputValue(T && t) {
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &chain) {
+            for (uint16_t i = 0; i < tx.outputCount; i++) {
+                auto &output = tx.getOutput(i);
+                total += isSpentRaw(output, chain) ? 0 : output.getValue();
             }
-            return total;
+        });
+        return total;
+    }
+    
+    // Equivalent to ranges::distance(inputsOfType(t, type))
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t inputCountOfType(T && t, AddressType::Enum type) {
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->inputCountByType[static_cast<size_t>(type)];
+        }
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &) {
+            for (uint16_t i = 0; i < tx.inputCount; i++) {
+                total += tx.getInput(i).getType() == type;
+            }
+        });
+        return total;
+    }
+    
+    // Equivalent to ranges::distance(outputsOfType(t, type))
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t outputCountOfType(T && t, AddressType::Enum type) {
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->outputCountByType[static_cast<size_t>(type)];
+        }
+        uint64_t total = 0;
+        forEachRawTx(std::forward<T>(t), [&](const RawTransaction &tx, const ChainAccess &) {
+            for (uint16_t i = 0; i < tx.outputCount; i++) {
+                total += tx.getOutput(i).getType() == type;
+            }
+        });
+        return total;
+    }
+    
+    inline uint64_t fee(const Transaction &tx) {
+        if (auto txFee = tx.getAccess().chain->getTxFees(tx.txNum)) {
+            return *txFee;
         }
+        return fee(tx.rawTx());
     }
 
     template <typename T>
@@ -231,9 +503,31 @@ namespace blocksci {
         return ranges::view::transform(txes(t), feePerByte);
     }
     
-    template <typename T>
-    inline uint64_t totalFee(T &t) {
-        return ranges::accumulate(fees(t), uint64_t{0});
+    // Same values as fees(t) in a contiguous array. Runs of consecutive transactions are copied straight from the fee column
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline std::vector<uint64_t> collectFees(T && t) {
+        std::vector<uint64_t> txFees;
+        forEachTxRun(std::forward<T>(t), [&](const ChainAccess &chain, uint32_t firstTx, uint32_t endTx) {
+            if (auto values = detail::txColumnRun(chain, &ChainAccess::getTxFees, firstTx, endTx)) {
+                txFees.insert(txFees.end(), values, values + (endTx - firstTx));
+            } else {
+                auto rawFunc = [&](const RawTransaction &tx, const ChainAccess &) {
+                    txFees.push_back(fee(tx));
+                };
+                detail::forEachRawTxInRange(chain, firstTx, endTx, rawFunc);
+            }
+        });
+        return txFees;
+    }
+    
+    template <typename T, std::enable_if_t<hasRawTxes<T>, int> = 0>
+    inline uint64_t totalFee(T && t) {
+        if (auto stats = detail::recordedBlockStats(t)) {
+            return stats->fee;
+        }
+        return detail::sumTxColumn(std::forward<T>(t), &ChainAccess::getTxFees, [](const RawTransaction &tx) {
+            return fee(tx);
+        });
     }
 }
 
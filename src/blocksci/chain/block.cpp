@@ -13,6 +13,7 @@
 #include "output.hpp"
 #include "input.hpp"
 #include "transaction_summary.hpp"
+#include "algorithms.hpp"
 #include "address/address.hpp"
 #include "scripts/nulldata_script.hpp"
 
@@ -56,6 +57,17 @@ namespace blocksci {
         return (*this)[0];
     }
     
+    RawBlockStats Block::stats() const {
+        if (auto recorded = access->chain->getBlockStats(blockNum)) {
+            return *recorded;
+        }
+        RawBlockStats blockStats;
+        forEachRawTx(*this, [&](const RawTransaction &tx, const ChainAccess &) {
+            blockStats.addTransaction(tx);
+        });
+        return blockStats;
+    }
+    
     bool isSegwit(const Block &block) {
         auto coinbase = block.coinbaseTx();
         for (int i = coinbase.outputCount() - 1; i >= 0; i--) {
@@ -78,12 +90,11 @@ namespace blocksci {
     
     std::unordered_map<AddressType::Enum, int64_t> netAddressTypeValue(const Block &block) {
         std::unordered_map<AddressType::Enum, int64_t> net;
-        RANGES_FOR(auto tx, block) {
-            RANGES_FOR(auto output, tx.outputs()) {
-                net[output.getType()] += output.getValue();
-            }
-            RANGES_FOR(auto input, tx.inputs()) {
-                net[input.getType()] -= input.getValue();
+        auto blockStats = block.stats();
+        for (size_t i = 0; i < AddressType::size; i++) {
+            if (blockStats.inputCountByType[i] > 0 || blockStats.outputCountByType[i] > 0) {
+                auto type = static_cast<AddressType::Enum>(i);
+                net[type] = blockStats.netValue(type);
             }
         }
         return net;
@@ -12,6 +12,7 @@
 #include "chain_fwd.hpp"
 #include "transaction.hpp"
 #include "raw_block.hpp"
+#include "block_stats.hpp"
 
 #include <blocksci/util/data_access.hpp>
 #include <blocksci/scripts/scripts_fwd.hpp>
@@ -190,6 +191,9 @@ namespace blocksci {
         
         std::vector<unsigned char> getCoinbase() const;
         Transaction coinbaseTx() const;
+        
+        // Aggregates recorded by the parser, computed from the transactions for data parsed before they existed
+        RawBlockStats stats() const;
     };
 
     bool isSegwit(const Block &block);
@@ -0,0 +1,37 @@
+//
+//  block_stats.cpp
+//  blocksci
+//
+
+#include "block_stats.hpp"
+#include "algorithms.hpp"
+#include "raw_transaction.hpp"
+
+namespace blocksci {
+    void RawBlockStats::addTransaction(const RawTransaction &tx) {
+        for (uint16_t i = 0; i < tx.inputCount; i++) {
+            auto &input = tx.getInput(i);
+            auto type = static_cast<size_t>(input.getType());
+            inputCountByType[type]++;
+            inputValueByType[type] += input.getValue();
+        }
+        for (uint16_t i = 0; i < tx.outputCount; i++) {
+            auto &output = tx.getOutput(i);
+            auto type = static_cast<size_t>(output.getType());
+            outputCountByType[type]++;
+            outputValueByType[type] += output.getValue();
+        }
+        
+        // Totals use the same helpers as the on the fly values so the two can't drift apart
+        fee += blocksci::fee(tx);
+        inputValue += blocksci::inputValue(tx);
+        outputValue += blocksci::outputValue(tx);
+        inputCount += tx.inputCount;
+        outputCount += tx.outputCount;
+        
+        // Only transactions carrying witness data serialize to more than their base size
+        if (tx.realSize != tx.baseSize) {
+            segwitTxCount++;
+        }
+    }
+}
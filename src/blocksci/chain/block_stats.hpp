@@ -0,0 +1,45 @@
+//
+//  block_stats.hpp
+//  blocksci
+//
+
+#ifndef block_stats_hpp
+#define block_stats_hpp
+
+#include "chain_fwd.hpp"
+
+#include <blocksci/address/address_types.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace blocksci {
+    struct RawTransaction;
+    
+    /* Aggregates of a single block, written by the parser to a fixed size record per block. Per type values are
+     * indexed by the AddressType::Enum value, so adding an address type requires the file to be regenerated
+     */
+    struct RawBlockStats {
+        uint64_t fee = 0;
+        uint64_t inputValue = 0;
+        uint64_t outputValue = 0;
+        std::array<uint64_t, AddressType::size> inputValueByType = {};
+        std::array<uint64_t, AddressType::size> outputValueByType = {};
+        std::array<uint32_t, AddressType::size> inputCountByType = {};
+        std::array<uint32_t, AddressType::size> outputCountByType = {};
+        uint32_t inputCount = 0;
+        uint32_t outputCount = 0;
+        uint32_t segwitTxCount = 0;
+        uint32_t padding = 0;
+        
+        void addTransaction(const RawTransaction &tx);
+        
+        // Output value minus input value of the given type, which is the change in the utxo pool for that type
+        int64_t netValue(AddressType::Enum type) const {
+            auto i = static_cast<size_t>(type);
+            return static_cast<int64_t>(outputValueByType[i]) - static_cast<int64_t>(inputValueByType[i]);
+        }
+    };
+}
+
+#endif /* block_stats_hpp */
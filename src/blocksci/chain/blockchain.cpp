@@ -15,6 +15,10 @@
 #include "chain/chain_access.hpp"
 #include "index/address_index.hpp"
 #include "index/hash_index.hpp"
+#include "index/address_prefix_index.hpp"
+#include "index/balance_log.hpp"
+#include "index/utxo_snapshots.hpp"
+#include "index/nested_equiv_index.hpp"
 
 #include "util/data_configuration.hpp"
 
@@ -29,6 +33,9 @@
 namespace blocksci {
     // [start, end)
     std::vector<std::vector<Block>> segmentChain(const Blockchain &chain, BlockHeight startBlock, BlockHeight endBlock, unsigned int segmentCount) {
+        if (startBlock >= endBlock) {
+            return {};
+        }
         auto lastTx = chain[endBlock - BlockHeight{1}].endTxIndex();
         auto firstTx = chain[startBlock].firstTxIndex();
         auto totalTxCount = lastTx - firstTx;
@@ -39,17 +46,23 @@ namespace blocksci {
         std::advance(it, static_cast<int>(startBlock));
         auto chainEnd = chain.begin();
         std::advance(chainEnd, static_cast<int>(endBlock));
-        while(lastTx - (*it).firstTxIndex() > segmentSize) {
+        while(it != chainEnd && lastTx - (*it).firstTxIndex() > segmentSize) {
             auto endIt = std::lower_bound(it, chainEnd, (*it).firstTxIndex() + segmentSize, [](const Block &block, uint32_t txNum) {
                 return block.firstTxIndex() < txNum;
             });
+            // Segments smaller than one transaction would otherwise never advance
+            if (endIt == it) {
+                ++endIt;
+            }
             segments.push_back(std::vector<Block>(it, endIt));
             it = endIt;
         }
-        if (segments.size() == segmentCount) {
-            segments.back().insert(segments.back().end(), it, chainEnd);
-        } else {
-            segments.push_back(std::vector<Block>(it, chainEnd));
+        if (it != chainEnd) {
+            if (segments.size() >= segmentCount) {
+                segments.back().insert(segments.back().end(), it, chainEnd);
+            } else {
+                segments.push_back(std::vector<Block>(it, chainEnd));
+            }
         }
         return segments;
     }
@@ -65,20 +78,24 @@ namespace blocksci {
         std::advance(it, static_cast<int>(startBlock));
         auto chainEnd = chain.begin();
         std::advance(chainEnd, static_cast<int>(endBlock));
-        while(lastTx - (*it).firstTxIndex() > segmentSize) {
+        while(it != chainEnd && lastTx - (*it).firstTxIndex() > segmentSize) {
             auto endIt = std::lower_bound(it, chainEnd, (*it).firstTxIndex() + segmentSize, [](const Block &block, uint32_t txNum) {
                 return block.firstTxIndex() < txNum;
             });
+            if (endIt == it) {
+                ++endIt;
+            }
             auto startBlock = *it;
-            auto endBlock = *endIt;
-            segments.emplace_back(startBlock.height(), endBlock.height());
+            segments.emplace_back(startBlock.height(), endIt == chainEnd ? endBlock : (*endIt).height());
             it = endIt;
         }
-        if (segments.size() == segmentCount) {
-            segments.back().second = endBlock;
-        } else {
-            auto startBlock = *it;
-            segments.emplace_back(startBlock.height(), endBlock);
+        if (it != chainEnd) {
+            if (segments.size() >= segmentCount) {
+                segments.back().second = endBlock;
+            } else {
+                auto startBlock = *it;
+                segments.emplace_back(startBlock.height(), endBlock);
+            }
         }
         return segments;
     }
@@ -91,6 +108,16 @@ namespace blocksci {
     
     Blockchain::~Blockchain() = default;
     
+    void Blockchain::refresh() {
+        access.chain->refresh();
+        access.scripts->reload();
+        access.prefixIndex->reload();
+        access.balanceLog->reload();
+        access.utxoSnapshots->reload();
+        access.nestedEquivIndex->reload();
+        lastBlockHeight = access.chain->blockCount();
+    }
+    
     template<AddressType::Enum type>
     struct ScriptRangeFunctor {
         static ScriptRangeVariant f(const Blockchain &chain) {
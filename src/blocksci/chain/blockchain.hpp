@@ -14,13 +14,13 @@
 #include <blocksci/scripts/script_access.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 #include <blocksci/util/data_access.hpp>
+#include <blocksci/util/parallel.hpp>
 
 #include <range/v3/view_facade.hpp>
 #include <range/v3/view/any_view.hpp>
 #include <range/v3/range_for.hpp>
 
 #include <type_traits>
-#include <future>
 
 namespace blocksci {
     struct DataConfiguration;
@@ -37,27 +37,6 @@ namespace blocksci {
         static constexpr bool value = decltype(test<F>(nullptr))::value;
     };
     
-    template <typename ResultType, typename It, typename MapFunc, typename ReduceFunc>
-    ResultType mapReduceBlocksImp(It begin, It end, MapFunc mapFunc, ReduceFunc reduceFunc) {
-        auto segmentCount = std::distance(begin, end);
-        if(segmentCount == 1) {
-            ResultType res{};
-            auto ret = mapFunc(*begin);
-            res = reduceFunc(res, ret);
-            return res;
-        } else {
-            auto mid = begin;
-            std::advance(mid, segmentCount / 2);
-            auto handle = std::async(std::launch::async, mapReduceBlocksImp<ResultType, It, MapFunc, ReduceFunc>, begin, mid, mapFunc, reduceFunc);
-            ResultType res{};
-            auto ret1 = mapReduceBlocksImp<ResultType>(mid, end, mapFunc, reduceFunc);
-            res = reduceFunc(res, ret1);
-            auto ret2 = handle.get();
-            res = reduceFunc(res, ret2);
-            return res;
-        }
-    }
-    
     class Blockchain;
     
     std::vector<std::vector<Block>> segmentChain(const Blockchain &chain, BlockHeight startBlock, BlockHeight endBlock, unsigned int segmentCount);
@@ -139,6 +118,7 @@ namespace blocksci {
         };
         
         cursor begin_cursor() const {
+            access.chain->reorgCheck();
             return cursor(*this, BlockHeight{0});
         }
         
@@ -158,6 +138,14 @@ namespace blocksci {
         
         const DataAccess &getAccess() const { return access; }
         
+        // Picks up blocks the parser has added since the chain was loaded, throwing ReorgException if it removed any
+        void refresh();
+        
+        // Pool used for parallel queries, sized by the threadCount of the data configuration
+        ThreadPool &threadPool() const {
+            return getThreadPool(access.config.threadCount);
+        }
+        
         uint32_t firstTxIndex() const;
         uint32_t endTxIndex() const;
         
@@ -181,8 +169,16 @@ namespace blocksci {
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
         std::enable_if_t<is_callable<MapFunc, std::vector<Block>>::value, ResultType>
         mapReduce(BlockHeight start, BlockHeight stop, MapFunc mapFunc, ReduceFunc reduceFunc) const {
-            auto segments = segmentChain(*this, start, stop, std::thread::hardware_concurrency());
-            return mapReduceBlocksImp<ResultType>(segments.begin(), segments.end(), mapFunc, reduceFunc);
+            access.chain->reorgCheck();
+            // Many more segments than threads so that idle workers can steal from ones stuck on heavy blocks
+            auto &pool = threadPool();
+            auto segments = segmentChain(*this, start, stop, pool.size() * parallelChunksPerThread);
+            return parallelReduce(pool, 0, segments.size(), ResultType{}, [&](ResultType &res, uint64_t i) {
+                auto ret = mapFunc(segments[i]);
+                res = reduceFunc(res, ret);
+            }, [&](ResultType &res, ResultType &segmentRes) {
+                res = reduceFunc(res, segmentRes);
+            });
         }
 
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
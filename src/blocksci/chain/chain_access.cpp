@@ -19,6 +19,9 @@
 
 #include <range/v3/iterator_range.hpp>
 
+#include <algorithm>
+#include <utility>
+
 namespace blocksci {
     
     ReorgException::ReorgException() : std::runtime_error("") {}
@@ -26,6 +29,8 @@ namespace blocksci {
     ReorgException::~ReorgException() = default;
     
     void ChainAccess::setup() {
+        loadedEpoch = chainEpochFile.size() > 0 ? *chainEpochFile.getData(0) : 0;
+        lastBlockHashDisk = nullptr;
         maxHeight = static_cast<BlockHeight>(blockFile.size()) - blocksIgnored;
         if (maxHeight > BlockHeight(0)) {
             const auto &blockFile_ = blockFile;
@@ -41,9 +46,17 @@ namespace blocksci {
     ChainAccess::ChainAccess(const DataConfiguration &config) :
     blockFile(config.blockFilePath()),
     blockCoinbaseFile(config.blockCoinbaseFilePath()),
+    blockStatsFile(config.blockStatsFilePath()),
     txFile(config.txFilePath()),
     sequenceFile(config.sequenceFilePath()),
+    sparseSequenceFile(config.sparseSequenceFilePath()),
+    spendingInputFile(config.spendingInputFilePath()),
     txHashesFile(config.txHashesFilePath()),
+    txHeightsFile(config.txHeightsFilePath()),
+    txFeesFile(config.txFeesFilePath()),
+    txInputValuesFile(config.txInputValuesFilePath()),
+    txOutputValuesFile(config.txOutputValuesFilePath()),
+    chainEpochFile(config.chainEpochFilePath()),
     blocksIgnored(config.blocksIgnored),
     errorOnReorg(config.errorOnReorg) {
         setup();
@@ -52,20 +65,69 @@ namespace blocksci {
     void ChainAccess::reload() {
         blockFile.reload();
         blockCoinbaseFile.reload();
+        blockStatsFile.reload();
         txFile.reload();
+        sequenceFile.reload();
+        sparseSequenceFile.reload();
         txHashesFile.reload();
+        spendingInputFile.reload();
+        txHeightsFile.reload();
+        txFeesFile.reload();
+        txInputValuesFile.reload();
+        txOutputValuesFile.reload();
+        chainEpochFile.reload();
         setup();
     }
     
+    void ChainAccess::reorgCheck() const {
+        if (!errorOnReorg) {
+            return;
+        }
+        if (chainEpochFile.size() > 0) {
+            if (*chainEpochFile.getData(0) != loadedEpoch) {
+                throw ReorgException();
+            }
+        } else if (lastBlockHashDisk != nullptr && lastBlockHash != *lastBlockHashDisk) {
+            // Data without an epoch can only be checked against the last loaded block
+            throw ReorgException();
+        }
+    }
+    
+    void ChainAccess::refresh() {
+        reorgCheck();
+        reload();
+    }
+    
+    uint32_t ChainAccess::getSequenceNumber(uint32_t txIndex, uint16_t inputNum) const {
+        if (txIndex < sequenceFile.size()) {
+            return sequenceFile.getData(txIndex)[inputNum];
+        }
+        auto count = sparseSequenceFile.size();
+        if (count == 0) {
+            return defaultSequenceNum;
+        }
+        auto first = sparseSequenceFile.getData(0);
+        auto last = first + count;
+        auto it = std::lower_bound(first, last, std::make_pair(txIndex, uint32_t{inputNum}), [](const SparseSequenceNum &a, const std::pair<uint32_t, uint32_t> &b) {
+            return std::make_pair(a.txNum, a.inputNum) < b;
+        });
+        if (it != last && it->txNum == txIndex && it->inputNum == inputNum) {
+            return it->sequenceNum;
+        }
+        return defaultSequenceNum;
+    }
+    
     size_t ChainAccess::txCount() const {
         return _maxLoadedTx;
     }
     
     BlockHeight ChainAccess::getBlockHeight(uint32_t txIndex) const {
-        reorgCheck();
         if (errorOnReorg && txIndex >= _maxLoadedTx) {
             throw std::out_of_range("Transaction index out of range");
         }
+        if (txIndex < _maxLoadedTx && txIndex < txHeightsFile.size()) {
+            return *txHeightsFile.getData(txIndex);
+        }
         auto blockRange = ranges::make_iterator_range(blockFile.getData(0), blockFile.getData(static_cast<size_t>(static_cast<int>(maxHeight) - 1)) + 1);
         auto it = std::upper_bound(blockRange.begin(), blockRange.end(), txIndex, [](uint32_t index, const RawBlock &b) {
             return index < b.firstTxIndex;
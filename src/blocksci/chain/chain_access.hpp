@@ -13,10 +13,16 @@
 
 #include <blocksci/chain/raw_transaction.hpp>
 #include <blocksci/chain/raw_block.hpp>
+#include <blocksci/chain/block_stats.hpp>
 #include <blocksci/util/file_mapper.hpp>
 #include <blocksci/util/bitcoin_uint256.hpp>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 namespace blocksci {
     
@@ -30,15 +36,90 @@ namespace blocksci {
     
     struct DataConfiguration;
     
+    // Marks an output whose spending input hasn't been recorded
+    static constexpr uint16_t unknownSpendingInput = std::numeric_limits<uint16_t>::max();
+    
+    /* Output number spent by each input of tx, found among the outputs of getTx(input.linkedTxNum) that link back
+     * to txNum. Inputs only record the spent tx, address and value, so inputs sharing all three with another input
+     * of tx could have spent either output and get unknownSpendingInput instead of a guess.
+     */
+    template <typename GetTx>
+    std::vector<uint16_t> spentOutputNums(const RawTransaction &tx, uint32_t txNum, GetTx getTx) {
+        auto key = [&](uint16_t i) {
+            auto &input = tx.getInput(i);
+            return std::make_tuple(input.linkedTxNum, input.toAddressNum, input.getValue());
+        };
+        std::vector<uint16_t> order(tx.inputCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) { return key(a) < key(b); });
+        
+        std::vector<uint16_t> outputNums(tx.inputCount, unknownSpendingInput);
+        for (size_t i = 0; i < order.size(); i++) {
+            auto inputNum = order[i];
+            if ((i > 0 && key(order[i - 1]) == key(inputNum)) || (i + 1 < order.size() && key(order[i + 1]) == key(inputNum))) {
+                continue;
+            }
+            auto &input = tx.getInput(inputNum);
+            const RawTransaction &spentTx = *getTx(input.linkedTxNum);
+            for (uint16_t j = 0; j < spentTx.outputCount; j++) {
+                auto &output = spentTx.getOutput(j);
+                if (output.linkedTxNum == txNum && output.toAddressNum == input.toAddressNum && output.getValue() == input.getValue()) {
+                    outputNums[inputNum] = j;
+                    break;
+                }
+            }
+        }
+        return outputNums;
+    }
+    
+    // Sequence number of almost every input, so only inputs with a different value are stored
+    static constexpr uint32_t defaultSequenceNum = std::numeric_limits<uint32_t>::max();
+    
+    // Record in the sparse sequence file, which is sorted by txNum and then inputNum
+    struct SparseSequenceNum {
+        uint32_t txNum;
+        uint32_t inputNum;
+        uint32_t sequenceNum;
+    };
+    
     class ChainAccess {
         FixedSizeFileMapper<RawBlock> blockFile;
         SimpleFileMapper<> blockCoinbaseFile;
         
+        // Aggregates of each block. Data from older parsers may not have it yet
+        FixedSizeFileMapper<RawBlockStats> blockStatsFile;
+        
         IndexedFileMapper<AccessMode::readonly, RawTransaction> txFile;
+        
+        // Dense sequence numbers written by older parsers. The parser converts them to the sparse file when it next runs
         IndexedFileMapper<AccessMode::readonly, uint32_t> sequenceFile;
+        FixedSizeFileMapper<SparseSequenceNum> sparseSequenceFile;
+        
+        // Index of the input that spent each output, kept beside the tx data since Inout has no room for it
+        IndexedFileMapper<AccessMode::readonly, uint16_t> spendingInputFile;
         
         FixedSizeFileMapper<uint256> txHashesFile;
         
+        // Height of the block containing each transaction. Data from older parsers may not have it yet
+        FixedSizeFileMapper<BlockHeight> txHeightsFile;
+        
+        // Value columns of each transaction, kept apart so that consecutive transactions can be read as an array
+        FixedSizeFileMapper<uint64_t> txFeesFile;
+        FixedSizeFileMapper<uint64_t> txInputValuesFile;
+        FixedSizeFileMapper<uint64_t> txOutputValuesFile;
+        
+        static const uint64_t *getColumnValue(const FixedSizeFileMapper<uint64_t> &column, uint32_t index) {
+            if (index < column.size()) {
+                return column.getData(index);
+            } else {
+                return nullptr;
+            }
+        }
+        
+        // Counter the parser increments before it removes any blocks. Data from older parsers may not have it yet
+        FixedSizeFileMapper<uint64_t> chainEpochFile;
+        
+        uint64_t loadedEpoch;
         uint256 lastBlockHash;
         const uint256 *lastBlockHashDisk;
         BlockHeight maxHeight;
@@ -46,17 +127,19 @@ namespace blocksci {
         BlockHeight blocksIgnored;
         bool errorOnReorg;
         
-        void reorgCheck() const {
-            if (errorOnReorg && lastBlockHash != *lastBlockHashDisk) {
-                throw ReorgException();
-            }
-        }
-        
         void setup();
         
     public:
         ChainAccess(const DataConfiguration &config);
         
+        /* Throws ReorgException if blocks were removed since the data was loaded. Individual accesses aren't
+         * checked, so this runs once at the start of each query, such as iterating over or mapping the chain
+         */
+        void reorgCheck() const;
+        
+        // Loads blocks added since the data was loaded, after checking that none of the loaded ones were removed
+        void refresh();
+        
         uint32_t maxLoadedTx() const {
             return _maxLoadedTx;
         }
@@ -64,12 +147,20 @@ namespace blocksci {
         BlockHeight getBlockHeight(uint32_t txIndex) const;
         
         const RawBlock *getBlock(BlockHeight blockHeight) const {
-            reorgCheck();
             return blockFile.getData(static_cast<size_t>(static_cast<int>(blockHeight)));
         }
         
+        // Returns nullptr for blocks parsed before block stats were recorded
+        const RawBlockStats *getBlockStats(BlockHeight blockHeight) const {
+            auto index = static_cast<size_t>(static_cast<int>(blockHeight));
+            if (index < blockStatsFile.size()) {
+                return blockStatsFile.getData(index);
+            } else {
+                return nullptr;
+            }
+        }
+        
         const uint256 *getTxHash(uint32_t index) const {
-            reorgCheck();
             return txHashesFile.getData(index);
         }
         
@@ -77,8 +168,29 @@ namespace blocksci {
             return txFile.getData(index);
         }
         
-        const uint32_t *getSequenceNumbers(uint32_t index) const {
-            return sequenceFile.getData(index);
+        // Columns return nullptr for transactions parsed before they were recorded. Values of consecutive
+        // transactions are adjacent, so a non null result for the last transaction of a run covers the whole run
+        const uint64_t *getTxFees(uint32_t index) const {
+            return getColumnValue(txFeesFile, index);
+        }
+        
+        const uint64_t *getTxInputValues(uint32_t index) const {
+            return getColumnValue(txInputValuesFile, index);
+        }
+        
+        const uint64_t *getTxOutputValues(uint32_t index) const {
+            return getColumnValue(txOutputValuesFile, index);
+        }
+        
+        uint32_t getSequenceNumber(uint32_t txIndex, uint16_t inputNum) const;
+        
+        // Returns nullptr for transactions parsed before spending inputs were recorded
+        const uint16_t *getSpendingInputNums(uint32_t index) const {
+            if (index < spendingInputFile.size()) {
+                return spendingInputFile.getData(index);
+            } else {
+                return nullptr;
+            }
         }
         
         size_t txCount() const;
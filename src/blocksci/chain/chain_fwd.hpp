@@ -46,6 +46,7 @@ namespace blocksci {
     struct InoutPointer;
     struct OutputPointer;
     struct InputPointer;
+    struct BalanceChange;
 }
 
 #endif /* chain_fwd_h */
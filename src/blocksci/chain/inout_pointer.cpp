@@ -18,6 +18,7 @@
 #include <range/v3/action/unique.hpp>
 #include <range/v3/action/sort.hpp>
 
+#include <algorithm>
 #include <unordered_set>
 #include <sstream>
 
@@ -60,6 +61,36 @@ namespace blocksci {
         return value;
     }
     
+    std::vector<BalanceChange> balanceHistory(const std::vector<OutputPointer> &pointers, const DataAccess &access) {
+        std::vector<std::pair<BlockHeight, int64_t>> changes;
+        for (auto &output : getOutputs(pointers, access)) {
+            auto value = static_cast<int64_t>(output.getValue());
+            changes.emplace_back(output.blockHeight, value);
+            auto spendingTx = output.getSpendingTx();
+            if (spendingTx) {
+                changes.emplace_back(spendingTx->blockHeight, -value);
+            }
+        }
+        return balanceHistory(std::move(changes));
+    }
+    
+    std::vector<BalanceChange> balanceHistory(std::vector<std::pair<BlockHeight, int64_t>> changes) {
+        std::sort(changes.begin(), changes.end(), [](const auto &a, const auto &b) {
+            return a.first < b.first;
+        });
+        std::vector<BalanceChange> history;
+        int64_t balance = 0;
+        for (auto &change : changes) {
+            balance += change.second;
+            if (!history.empty() && history.back().height == change.first) {
+                history.back().balance = static_cast<uint64_t>(balance);
+            } else {
+                history.push_back(BalanceChange{change.first, static_cast<uint64_t>(balance)});
+            }
+        }
+        return history;
+    }
+    
     std::vector<Output> getOutputs(const std::vector<OutputPointer> &pointers, const DataAccess &access) {
         return pointers
         | ranges::view::transform([&access](const OutputPointer &pointer) { return Output(pointer, access); })
@@ -70,12 +101,9 @@ namespace blocksci {
         std::unordered_set<InputPointer> allPointers;
         allPointers.reserve(pointers.size());
         for (auto &pointer : pointers) {
-            auto inputTx = Output(pointer, access).getSpendingTx();
-            if(inputTx) {
-                auto inputPointers = inputTx->getInputPointers(pointer);
-                for (auto &inputPointer : inputPointers) {
-                    allPointers.insert(inputPointer);
-                }
+            auto inputPointer = Output(pointer, access).getSpendingInputPointer();
+            if (inputPointer) {
+                allPointers.insert(*inputPointer);
             }
         }
         return allPointers
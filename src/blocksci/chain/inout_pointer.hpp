@@ -14,6 +14,7 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <utility>
 
 namespace blocksci {
     class DataAccess;
@@ -66,7 +67,17 @@ namespace blocksci {
         std::string toString() const;
     };
     
+    // Balance after every change made in the block at height
+    struct BalanceChange {
+        BlockHeight height;
+        uint64_t balance;
+    };
+    
     uint64_t calculateBalance(const std::vector<OutputPointer> &pointers, BlockHeight height, const DataAccess &access);
+    std::vector<BalanceChange> balanceHistory(const std::vector<OutputPointer> &pointers, const DataAccess &access);
+    
+    // Running balance for a set of (height, change) pairs in any order, with one entry per height
+    std::vector<BalanceChange> balanceHistory(std::vector<std::pair<BlockHeight, int64_t>> changes);
     std::vector<Output> getOutputs(const std::vector<OutputPointer> &pointers, const DataAccess &access);
     std::vector<Input> getInputs(const std::vector<OutputPointer> &pointers, const DataAccess &access);
     std::vector<Transaction> getTransactions(const std::vector<OutputPointer> &pointers, const DataAccess &access);
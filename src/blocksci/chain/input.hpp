@@ -29,7 +29,6 @@ namespace blocksci {
     class Input {
         const DataAccess *access;
         const Inout *inout;
-        const uint32_t *sequenceNum;
         InputPointer pointer;
         
         friend size_t std::hash<Input>::operator()(const Input &) const;
@@ -37,12 +36,12 @@ namespace blocksci {
         
         BlockHeight blockHeight;
 
-        Input(const InputPointer &pointer_, BlockHeight blockHeight_, const Inout &inout_, const uint32_t *sequenceNum_, const DataAccess &access_) :
-        access(&access_), inout(&inout_), sequenceNum(sequenceNum_), pointer(pointer_), blockHeight(blockHeight_) {
+        Input(const InputPointer &pointer_, BlockHeight blockHeight_, const Inout &inout_, const DataAccess &access_) :
+        access(&access_), inout(&inout_), pointer(pointer_), blockHeight(blockHeight_) {
             assert(pointer.isValid(*access_.chain));
         }
         Input(const InputPointer &pointer_, const DataAccess &access_) :
-        Input(pointer_, access_.chain->getBlockHeight(pointer_.txNum), access_.chain->getTx(pointer_.txNum)->getInput(pointer_.inoutNum), &access_.chain->getSequenceNumbers(pointer_.txNum)[pointer_.inoutNum], access_) {}
+        Input(pointer_, access_.chain->getBlockHeight(pointer_.txNum), access_.chain->getTx(pointer_.txNum)->getInput(pointer_.inoutNum), access_) {}
         
         uint32_t txIndex() const {
             return pointer.txNum;
@@ -52,8 +51,9 @@ namespace blocksci {
             return pointer.inoutNum;
         }
         
+        // Looked up on demand since almost no analysis needs it
         uint32_t sequenceNumber() const {
-            return *sequenceNum;
+            return access->chain->getSequenceNumber(pointer.txNum, pointer.inoutNum);
         }
         
         Transaction transaction() const;
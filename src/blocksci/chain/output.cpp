@@ -12,6 +12,7 @@
 #include "block.hpp"
 #include "inout_pointer.hpp"
 #include "transaction.hpp"
+#include "input.hpp"
 #include "address/address.hpp"
 #include "scripts/script_variant.hpp"
 #include "util/hash.hpp"
@@ -45,6 +46,31 @@ namespace blocksci {
             return ranges::nullopt;
         }
     }
+    
+    ranges::optional<InputPointer> Output::getSpendingInputPointer() const {
+        if (!isSpent()) {
+            return ranges::nullopt;
+        }
+        auto inputNums = access->chain->getSpendingInputNums(pointer.txNum);
+        if (inputNums != nullptr && inputNums[pointer.inoutNum] != unknownSpendingInput) {
+            return InputPointer{getSpendingTxIndex(), inputNums[pointer.inoutNum]};
+        }
+        // Fall back to searching the spending transaction's inputs
+        auto inputPointers = Transaction(getSpendingTxIndex(), *access).getInputPointers(pointer);
+        if (inputPointers.empty()) {
+            return ranges::nullopt;
+        }
+        return inputPointers.front();
+    }
+    
+    ranges::optional<Input> Output::getSpendingInput() const {
+        auto inputPointer = getSpendingInputPointer();
+        if (inputPointer) {
+            return Input(*inputPointer, *access);
+        } else {
+            return ranges::nullopt;
+        }
+    }
 }
 
 namespace std
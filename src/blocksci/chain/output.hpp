@@ -91,6 +91,8 @@ namespace blocksci {
 
         std::string toString() const;
         ranges::optional<Transaction> getSpendingTx() const;
+        ranges::optional<InputPointer> getSpendingInputPointer() const;
+        ranges::optional<Input> getSpendingInput() const;
     };
 
     inline std::ostream &operator<<(std::ostream &os, const Output &output) { 
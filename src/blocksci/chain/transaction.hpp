@@ -37,7 +37,6 @@ namespace blocksci {
     private:
         const DataAccess *access;
         const RawTransaction *data;
-        const uint32_t *sequenceNumbers;
         friend TransactionSummary;
     public:
         uint32_t txNum;
@@ -45,7 +44,7 @@ namespace blocksci {
         
         Transaction() = default;
         
-        Transaction(const RawTransaction *data_, uint32_t txNum_, BlockHeight blockHeight_, const DataAccess &access_) : access(&access_), data(data_), sequenceNumbers(access_.chain->getSequenceNumbers(txNum_)), txNum(txNum_), blockHeight(blockHeight_) {}
+        Transaction(const RawTransaction *data_, uint32_t txNum_, BlockHeight blockHeight_, const DataAccess &access_) : access(&access_), data(data_), txNum(txNum_), blockHeight(blockHeight_) {}
         
         Transaction(uint32_t index, const DataAccess &access_) : Transaction(index, access_.chain->getBlockHeight(index), access_) {}
         
@@ -97,6 +96,10 @@ namespace blocksci {
             return data->outputCount;
         }
         
+        const RawTransaction &rawTx() const {
+            return *data;
+        }
+        
         ranges::iterator_range<const Inout *> rawOutputs() const {
             auto &firstOut = data->getOutput(0);
             return ranges::make_iterator_range(&firstOut, &firstOut + outputCount());
@@ -120,9 +123,8 @@ namespace blocksci {
             auto dataAccess = access;
             uint32_t txIndex = txNum;
             BlockHeight height = blockHeight;
-            auto seq = sequenceNumbers;
-            return ranges::view::zip_with([dataAccess, txIndex, height, seq](uint16_t inputNum, const Inout &inout) {
-                return Input({txIndex, inputNum}, height, inout, &seq[inputNum], *dataAccess);
+            return ranges::view::zip_with([dataAccess, txIndex, height](uint16_t inputNum, const Inout &inout) {
+                return Input({txIndex, inputNum}, height, inout, *dataAccess);
             }, ranges::view::iota(uint16_t{0}, inputCount()), rawInputs());
         }
         
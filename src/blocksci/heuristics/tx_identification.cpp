@@ -10,8 +10,11 @@
 #include "util/hash.hpp"
 #include "scripts/script_variant.hpp"
 
+#include <algorithm>
 #include <unordered_set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace blocksci {
 namespace heuristics {
@@ -21,41 +24,57 @@ namespace heuristics {
             return false;
         }
         
-        uint16_t participantCount = (tx.outputCount() + 1) / 2;
-        if (participantCount > tx.inputCount()) {
-            return false;
-        }
-        
-        std::unordered_set<Address> inputAddresses;
+        std::vector<Address> inputAddresses;
+        inputAddresses.reserve(tx.inputCount());
         for (auto input : tx.inputs()) {
-            inputAddresses.insert(input.getAddress());
+            inputAddresses.push_back(input.getAddress());
+        }
+        std::vector<uint64_t> outputValues;
+        outputValues.reserve(tx.outputCount());
+        for (auto output : tx.outputs()) {
+            outputValues.push_back(output.getValue());
+        }
+        return isCoinjoin(inputAddresses, outputValues);
+    }
+    
+    bool isCoinjoin(std::vector<Address> &inputAddresses, std::vector<uint64_t> &outputValues) {
+        if (inputAddresses.size() < 2 || outputValues.size() < 3) {
+            return false;
         }
         
+        auto participantCount = (outputValues.size() + 1) / 2;
         if (participantCount > inputAddresses.size()) {
             return false;
         }
         
-        std::unordered_map<uint64_t, uint16_t> outputValues;
-        for (auto output : tx.outputs()) {
-            outputValues[output.getValue()]++;
+        std::sort(inputAddresses.begin(), inputAddresses.end(), [](const Address &a, const Address &b) {
+            return std::make_pair(a.type, a.scriptNum) < std::make_pair(b.type, b.scriptNum);
+        });
+        auto distinctInputCount = static_cast<size_t>(std::unique(inputAddresses.begin(), inputAddresses.end()) - inputAddresses.begin());
+        if (participantCount > distinctInputCount) {
+            return false;
         }
         
-        using pair_type = decltype(outputValues)::value_type;
-        auto pr = std::max_element(std::begin(outputValues), std::end(outputValues),
-                                   [] (const pair_type & p1, const pair_type & p2) {
-                                       return p1.second < p2.second;
-                                   }
-                                   );
-        
-        if (pr->second != participantCount) {
-            return false;
+        std::sort(outputValues.begin(), outputValues.end());
+        uint64_t mostCommonValue = 0;
+        size_t mostCommonCount = 0;
+        for (size_t runStart = 0; runStart < outputValues.size();) {
+            auto runEnd = runStart;
+            while (runEnd < outputValues.size() && outputValues[runEnd] == outputValues[runStart]) {
+                runEnd++;
+            }
+            if (runEnd - runStart > mostCommonCount) {
+                mostCommonCount = runEnd - runStart;
+                mostCommonValue = outputValues[runStart];
+            }
+            runStart = runEnd;
         }
         
-        if (pr->first == 546 || pr->first == 2730) {
+        if (mostCommonCount != participantCount) {
             return false;
         }
         
-        return true;
+        return mostCommonValue != 546 && mostCommonValue != 2730;
     }
     
     struct OutputBucket {
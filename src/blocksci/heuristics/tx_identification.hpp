@@ -10,7 +10,9 @@
 
 #include <blocksci/chain/chain_fwd.hpp>
 #include <blocksci/scripts/scripts_fwd.hpp>
+#include <blocksci/address/address.hpp>
 #include <stdio.h>
+#include <vector>
 
 namespace blocksci {
     class DataAccess;
@@ -21,6 +23,11 @@ namespace blocksci {
     };
     
     bool isCoinjoin(const Transaction &tx);
+    
+    /* isCoinjoin given a transaction's input addresses and output values, for callers that already have them.
+     * Both vectors are sorted in place. When several output values are equally common the smallest one is tested.
+     */
+    bool isCoinjoin(std::vector<Address> &inputAddresses, std::vector<uint64_t> &outputValues);
     CoinJoinResult isPossibleCoinjoin(const Transaction &tx, uint64_t minBaseFee, double percentageFee, size_t maxDepth);
     CoinJoinResult isCoinjoinExtra(const Transaction &tx, uint64_t minBaseFee, double percentageFee, size_t maxDepth);
     bool isDeanonTx(const Transaction &tx);
@@ -20,11 +20,15 @@
 #include "scripts/script_info.hpp"
 #include "scripts/script.hpp"
 #include "scripts/script_variant.hpp"
+#include "index/nested_equiv_index.hpp"
+#include "chain/chain_access.hpp"
+#include "util/data_access.hpp"
 
 #include <range/v3/utility/optional.hpp>
 #include <range/v3/view/filter.hpp>
 #include <range/v3/to_container.hpp>
 
+#include <memory>
 #include <unordered_set>
 #include <vector>
 #include <sstream>
@@ -131,75 +135,74 @@ namespace blocksci {
         return addresses;
     }
     
-    std::unordered_set<Address> AddressIndex::getPossibleNestedEquivalentDown(const Address &searchAddress) const {
-        std::unordered_set<Address> addressesToSearch{searchAddress};
-        std::unordered_set<Address> searchedAddresses;
-        std::function<bool(const blocksci::Address &)> visitFunc = [&](const blocksci::Address &a) {
-            if (dedupType(a.type) == DedupAddressType::SCRIPTHASH) {
-                script::ScriptHash scriptHash(a.scriptNum, searchAddress.getAccess());
-                auto wrapped = scriptHash.getWrappedAddress();
+    std::vector<DedupAddress> AddressIndex::getNestedComponent(const Address &searchAddress) const {
+        auto &access = searchAddress.getAccess();
+        DedupAddress start{searchAddress.scriptNum, dedupType(searchAddress.type)};
+        std::vector<DedupAddress> component{start};
+        std::unordered_set<DedupAddress> found{start};
+        auto addFound = [&](const DedupAddress &address) {
+            if (found.insert(address).second) {
+                component.push_back(address);
+            }
+        };
+        for (size_t i = 0; i < component.size(); i++) {
+            auto address = component[i];
+            if (address.type == DedupAddressType::SCRIPTHASH) {
+                auto wrapped = script::ScriptHash(address.scriptNum, access).getWrappedAddress();
                 if (wrapped) {
-                    for (auto type : equivAddressTypes(equivType(wrapped->type))) {
-                        Address newAddress(wrapped->scriptNum, type, searchAddress.getAccess());
-                        if (searchedAddresses.find(newAddress) == searchedAddresses.end()) {
-                            addressesToSearch.insert(newAddress);
-                        }
+                    addFound(DedupAddress{wrapped->scriptNum, dedupType(wrapped->type)});
+                }
+            }
+            rocksdb::Slice key{reinterpret_cast<const char *>(&address.scriptNum), sizeof(address.scriptNum)};
+            for (auto type : AddressType::all) {
+                if (dedupType(type) != address.type) {
+                    continue;
+                }
+                std::unique_ptr<rocksdb::Iterator> it{db->NewIterator(rocksdb::ReadOptions(), getNestedColumn(type))};
+                for (it->Seek(key); it->Valid() && it->key().starts_with(key); it->Next()) {
+                    auto foundKey = it->key();
+                    foundKey.remove_prefix(sizeof(uint32_t));
+                    DedupAddress rawParent;
+                    memcpy(&rawParent, foundKey.data(), sizeof(rawParent));
+                    // Multisigs contain their keys rather than wrapping them, so they aren't equivalent
+                    if (rawParent.type == DedupAddressType::SCRIPTHASH) {
+                        addFound(rawParent);
                     }
                 }
-                return true;
             }
-            return false;
-        };
-        while (addressesToSearch.size() > 0) {
-            auto setIt = addressesToSearch.begin();
-            auto address = *setIt;
-            visit(address, visitFunc);
-            searchedAddresses.insert(address);
-            addressesToSearch.erase(setIt);
         }
-        
-        return searchedAddresses;
+        return component;
     }
     
-    std::unordered_set<Address> AddressIndex::getPossibleNestedEquivalentUp(const Address &searchAddress) const {
-        std::unordered_set<Address> addressesToSearch{searchAddress};
-        std::unordered_set<Address> searchedAddresses;
-        while (addressesToSearch.size() > 0) {
-            auto setIt = addressesToSearch.begin();
-            auto address = *setIt;
-            auto column = getNestedColumn(address.type);
-            rocksdb::Slice key{reinterpret_cast<const char *>(&address.scriptNum), sizeof(address.scriptNum)};
-            rocksdb::Iterator* it = db->NewIterator(rocksdb::ReadOptions(), column);
-            for (it->Seek(key); it->Valid() && it->key().starts_with(key); it->Next()) {
-                auto foundKey = it->key();
-                foundKey.remove_prefix(sizeof(uint32_t));
-                DedupAddress rawParent;
-                memcpy(&rawParent, foundKey.data(), sizeof(rawParent));
-                switch (rawParent.type) {
-                    case DedupAddressType::SCRIPTHASH:
-                        for (auto type : equivAddressTypes(equivType(AddressType::SCRIPTHASH))) {
-                            Address newAddress(rawParent.scriptNum, type, searchAddress.getAccess());
-                            if (searchedAddresses.find(newAddress) == searchedAddresses.end()) {
-                                addressesToSearch.insert(newAddress);
-                            }
-                        }
-                        break;
-                    default:
-                        break;
+    std::vector<Address> AddressIndex::getPossibleNestedEquivalent(const Address &searchAddress) const {
+        auto &access = searchAddress.getAccess();
+        std::vector<Address> addresses;
+        auto addEquivalents = [&](const DedupAddress &dedupAddress) {
+            for (auto type : AddressType::all) {
+                if (dedupType(type) == dedupAddress.type) {
+                    addresses.emplace_back(dedupAddress.scriptNum, type, access);
+                }
+            }
+        };
+        
+        auto &equivIndex = *access.nestedEquivIndex;
+        if (equivIndex.isBuilt() && equivIndex.blockCount() >= access.chain->blockCount()) {
+            auto component = equivIndex.component(DedupAddress{searchAddress.scriptNum, dedupType(searchAddress.type)});
+            if (component == 0) {
+                addEquivalents(DedupAddress{searchAddress.scriptNum, dedupType(searchAddress.type)});
+            } else {
+                auto members = equivIndex.members(component);
+                for (auto it = members.first; it != members.second; ++it) {
+                    addEquivalents(*it);
                 }
             }
-            searchedAddresses.insert(address);
-            addressesToSearch.erase(setIt);
+            return addresses;
         }
         
-        return searchedAddresses;
-    }
-    
-    std::vector<Address> AddressIndex::getPossibleNestedEquivalent(const Address &searchAddress) const {
-        auto upAddresses = getPossibleNestedEquivalentUp(searchAddress);
-        auto downAddresses = getPossibleNestedEquivalentDown(searchAddress);
-        upAddresses.insert(downAddresses.begin(), downAddresses.end());
-        return std::vector<Address>{upAddresses.begin(), upAddresses.end()};
+        for (auto &dedupAddress : getNestedComponent(searchAddress)) {
+            addEquivalents(dedupAddress);
+        }
+        return addresses;
     }
     
     void AddressIndex::addAddressNested(const Address &childAddress, const DedupAddress &parentAddress) {
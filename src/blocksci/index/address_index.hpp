@@ -26,8 +26,8 @@ namespace blocksci {
         rocksdb::DB *db;
         std::vector<rocksdb::ColumnFamilyHandle *> columnHandles;
         
-        std::unordered_set<Address> getPossibleNestedEquivalentUp(const Address &address) const;
-        std::unordered_set<Address> getPossibleNestedEquivalentDown(const Address &address) const;
+        // Scripts linked to the address by script hash wrapping in either direction, found the same way as NestedEquivIndex
+        std::vector<DedupAddress> getNestedComponent(const Address &address) const;
         
     public:
         
@@ -36,6 +36,7 @@ namespace blocksci {
 
         bool checkIfExists(const Address &address) const;
         std::vector<OutputPointer> getOutputPointers(const Address &address) const;
+        // Every address type of the scripts in the address's nested component, from NestedEquivIndex when it is up to date
         std::vector<Address> getPossibleNestedEquivalent(const Address &address) const;
         std::vector<Address> getIncludingMultisigs(const Address &searchAddress) const;
         
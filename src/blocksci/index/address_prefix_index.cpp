@@ -0,0 +1,148 @@
+//
+//  address_prefix_index.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "address_prefix_index.hpp"
+
+#include <blocksci/address/address_encoder.hpp>
+#include <blocksci/address/address_info.hpp>
+#include <blocksci/scripts/script_access.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/data_configuration.hpp>
+
+#include <algorithm>
+
+namespace blocksci {
+    constexpr size_t AddressPrefixEntry::keyLength;
+    constexpr std::array<AddressType::Enum, 4> AddressPrefixIndex::indexedTypes;
+    constexpr size_t AddressPrefixIndex::tableCount;
+
+    namespace {
+        const char *tableNames[] = {"pubkeyhash", "scripthash", "witness_pubkeyhash", "witness_scripthash"};
+
+        constexpr uint32_t tailBatchSize = 4096;
+    }
+
+    boost::filesystem::path AddressPrefixIndex::tablePath(const DataConfiguration &config, size_t table) {
+        return config.addressPrefixIndexDirectory()/tableNames[table];
+    }
+
+    boost::filesystem::path AddressPrefixIndex::progressPath(const DataConfiguration &config) {
+        return config.addressPrefixIndexDirectory()/"progress";
+    }
+
+    std::string AddressPrefixIndex::sharedLead(const DataConfiguration &config, size_t table) {
+        switch (indexedTypes[table]) {
+            case AddressType::WITNESS_PUBKEYHASH:
+            case AddressType::WITNESS_SCRIPTHASH:
+                // Human readable part, separator and witness version 0
+                return config.segwitPrefix + "1q";
+            default:
+                return "";
+        }
+    }
+
+    bool AddressPrefixIndex::hasString(size_t table, uint32_t scriptNum, const ScriptAccess &scripts) {
+        switch (indexedTypes[table]) {
+            case AddressType::SCRIPTHASH:
+                return !scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->isSegwit;
+            case AddressType::WITNESS_SCRIPTHASH:
+                return scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->isSegwit;
+            default:
+                return true;
+        }
+    }
+
+    bool AddressPrefixIndex::prefixMayMatch(const DataConfiguration &config, size_t table, const std::string &prefix) {
+        auto lead = sharedLead(config, table);
+        auto length = std::min(prefix.size(), lead.size());
+        return prefix.compare(0, length, lead, 0, length) == 0;
+    }
+    
+    AddressPrefixEntry AddressPrefixIndex::makeEntry(const std::string &lead, const char *chars, size_t length, uint32_t scriptNum) {
+        AddressPrefixEntry entry;
+        memset(entry.key, 0, AddressPrefixEntry::keyLength);
+        auto keySize = std::min(length - std::min(length, lead.size()), AddressPrefixEntry::keyLength);
+        memcpy(entry.key, chars + lead.size(), keySize);
+        entry.scriptNum = scriptNum;
+        return entry;
+    }
+
+    AddressPrefixIndex::AddressPrefixIndex(const DataConfiguration &config) : progressFile(progressPath(config)) {
+        for (size_t i = 0; i < tableCount; i++) {
+            paths[i] = tablePath(config, i);
+            tables[i] = std::make_unique<FixedSizeFileMapper<AddressPrefixEntry>>(paths[i]);
+            leads[i] = sharedLead(config, i);
+        }
+    }
+
+    void AddressPrefixIndex::reload() {
+        // Updates replace the tables rather than appending to them, so they are always reopened
+        for (size_t i = 0; i < tableCount; i++) {
+            tables[i] = std::make_unique<FixedSizeFileMapper<AddressPrefixEntry>>(paths[i]);
+        }
+        progressFile.reload();
+    }
+
+    std::vector<Address> AddressPrefixIndex::lookup(const std::string &prefix, const DataAccess &access) const {
+        std::vector<Address> matches;
+        // Addresses whose key matches but whose full string still has to be compared with the prefix
+        std::vector<Address> candidates;
+        for (size_t i = 0; i < tableCount; i++) {
+            auto type = indexedTypes[i];
+            auto &lead = leads[i];
+            if (!prefixMayMatch(access.config, i, prefix)) {
+                continue;
+            }
+            auto remainder = prefix.size() > lead.size() ? prefix.substr(lead.size()) : std::string{};
+
+            auto scriptCount = access.scripts->scriptCount(dedupType(type));
+            auto indexedCount = isBuilt() ? std::min(*progressFile.getData(i), scriptCount) : 0;
+            auto needsCheck = remainder.size() > AddressPrefixEntry::keyLength;
+            auto &results = needsCheck ? candidates : matches;
+
+            auto &table = *tables[i];
+            if (table.size() > 0) {
+                auto keySize = std::min(remainder.size(), AddressPrefixEntry::keyLength);
+                auto first = table.getData(0);
+                auto last = first + table.size();
+                auto begin = std::lower_bound(first, last, remainder, [&](const AddressPrefixEntry &entry, const std::string &key) {
+                    return memcmp(entry.key, key.data(), keySize) < 0;
+                });
+                auto end = std::upper_bound(begin, last, remainder, [&](const std::string &key, const AddressPrefixEntry &entry) {
+                    return memcmp(key.data(), entry.key, keySize) < 0;
+                });
+                for (auto it = begin; it != end; ++it) {
+                    // Rollbacks lower the progress without removing entries
+                    if (it->scriptNum <= indexedCount) {
+                        results.emplace_back(it->scriptNum, type, access);
+                    }
+                }
+            }
+
+            for (auto scriptNum = indexedCount + 1; scriptNum <= scriptCount; scriptNum++) {
+                if (hasString(i, scriptNum, *access.scripts)) {
+                    candidates.emplace_back(scriptNum, type, access);
+                }
+            }
+        }
+
+        if (!candidates.empty()) {
+            AddressEncoder encoder(access.config);
+            std::vector<AddressString> strings(tailBatchSize);
+            for (size_t batchStart = 0; batchStart < candidates.size(); batchStart += tailBatchSize) {
+                auto batchCount = std::min<size_t>(tailBatchSize, candidates.size() - batchStart);
+                encoder.encode(candidates.data() + batchStart, batchCount, strings.data());
+                for (size_t j = 0; j < batchCount; j++) {
+                    if (strings[j].startsWith(prefix)) {
+                        matches.push_back(candidates[batchStart + j]);
+                    }
+                }
+            }
+        }
+        return matches;
+    }
+}
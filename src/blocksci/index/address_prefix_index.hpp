@@ -0,0 +1,82 @@
+//
+//  address_prefix_index.hpp
+//  blocksci
+//
+
+#ifndef address_prefix_index_hpp
+#define address_prefix_index_hpp
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/util/file_mapper.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class ScriptAccess;
+
+    // Start of an address string after the characters shared by every address of its type, with its script number
+    struct AddressPrefixEntry {
+        static constexpr size_t keyLength = 12;
+
+        char key[keyLength];
+        uint32_t scriptNum;
+
+        bool operator<(const AddressPrefixEntry &other) const {
+            auto cmp = memcmp(key, other.key, keyLength);
+            return cmp < 0 || (cmp == 0 && scriptNum < other.scriptNum);
+        }
+    };
+
+    /* Optional index of address strings built by the parser. Each address type with a string form has a table of
+     * AddressPrefixEntry sorted by key, so a prefix query is a binary search. Prefixes longer than the key are
+     * checked by encoding the candidates, and scripts added since the index was last updated are scanned.
+     */
+    class AddressPrefixIndex {
+    public:
+        static constexpr std::array<AddressType::Enum, 4> indexedTypes = {{AddressType::PUBKEYHASH, AddressType::SCRIPTHASH, AddressType::WITNESS_PUBKEYHASH, AddressType::WITNESS_SCRIPTHASH}};
+        static constexpr size_t tableCount = indexedTypes.size();
+
+        static boost::filesystem::path tablePath(const DataConfiguration &config, size_t table);
+
+        // Holds the number of scripts of each table's type that have been added to it
+        static boost::filesystem::path progressPath(const DataConfiguration &config);
+
+        // Characters at the start of every address string of the table's type, which are left out of the key
+        static std::string sharedLead(const DataConfiguration &config, size_t table);
+
+        /* Whether the script has a string form as the table's type. Script hashes are stored once for P2SH and P2WSH,
+         * so each only gets the string of the type it was seen as: a segwit script hash is a "bc1q..." address and
+         * never a "3..." one. The scan used without the index follows the same rule.
+         */
+        static bool hasString(size_t table, uint32_t scriptNum, const ScriptAccess &scripts);
+        
+        // False if no string of the table's type can start with the prefix
+        static bool prefixMayMatch(const DataConfiguration &config, size_t table, const std::string &prefix);
+
+        static AddressPrefixEntry makeEntry(const std::string &lead, const char *chars, size_t length, uint32_t scriptNum);
+
+        explicit AddressPrefixIndex(const DataConfiguration &config);
+
+        bool isBuilt() const {
+            return progressFile.size() == tableCount;
+        }
+
+        std::vector<Address> lookup(const std::string &prefix, const DataAccess &access) const;
+
+        void reload();
+
+    private:
+        std::array<boost::filesystem::path, tableCount> paths;
+        std::array<std::unique_ptr<FixedSizeFileMapper<AddressPrefixEntry>>, tableCount> tables;
+        std::array<std::string, tableCount> leads;
+        FixedSizeFileMapper<uint32_t> progressFile;
+    };
+}
+
+#endif /* address_prefix_index_hpp */
@@ -0,0 +1,83 @@
+//
+//  balance_log.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "balance_log.hpp"
+
+#include <blocksci/address/address_info.hpp>
+#include <blocksci/util/data_configuration.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace blocksci {
+    boost::filesystem::path BalanceLog::offsetsPath(const DataConfiguration &config, AddressType::Enum type) {
+        return config.balanceLogDirectory()/(addressName(type) + "_offsets");
+    }
+    
+    boost::filesystem::path BalanceLog::dataPath(const DataConfiguration &config, AddressType::Enum type) {
+        return config.balanceLogDirectory()/(addressName(type) + "_data");
+    }
+    
+    boost::filesystem::path BalanceLog::progressPath(const DataConfiguration &config) {
+        return config.balanceLogDirectory()/"progress";
+    }
+    
+    BalanceLog::BalanceLog(const DataConfiguration &config) : progressFile(progressPath(config)) {
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            offsetsPaths[i] = offsetsPath(config, type);
+            dataPaths[i] = dataPath(config, type);
+        }
+        openTables();
+    }
+    
+    void BalanceLog::openTables() {
+        for (size_t i = 0; i < AddressType::size; i++) {
+            offsetsFiles[i] = std::make_unique<FixedSizeFileMapper<uint64_t>>(offsetsPaths[i]);
+            dataFiles[i] = std::make_unique<FixedSizeFileMapper<BalanceChange>>(dataPaths[i]);
+        }
+    }
+    
+    void BalanceLog::reload() {
+        // Updates replace the files rather than appending to them, so they are always reopened
+        openTables();
+        progressFile.reload();
+    }
+    
+    std::pair<const BalanceChange *, const BalanceChange *> BalanceLog::changes(const Address &address) const {
+        auto typeIndex = static_cast<size_t>(address.type);
+        auto &offsetsFile = *offsetsFiles[typeIndex];
+        if (address.scriptNum == 0 || address.scriptNum >= offsetsFile.size()) {
+            return {nullptr, nullptr};
+        }
+        auto first = *offsetsFile.getData(address.scriptNum - 1);
+        auto last = *offsetsFile.getData(address.scriptNum);
+        if (first == last) {
+            return {nullptr, nullptr};
+        }
+        auto begin = dataFiles[typeIndex]->getData(first);
+        auto end = begin + (last - first);
+        // Changes from blocks removed by a rollback stay in the log until the next update
+        end = std::lower_bound(begin, end, blockCount(), [](const BalanceChange &change, BlockHeight height) {
+            return change.height < height;
+        });
+        return {begin, end};
+    }
+    
+    uint64_t BalanceLog::balance(const Address &address, BlockHeight height) const {
+        auto run = changes(address);
+        auto it = std::upper_bound(run.first, run.second, height, [](BlockHeight height, const BalanceChange &change) {
+            return height < change.height;
+        });
+        return it == run.first ? 0 : std::prev(it)->balance;
+    }
+    
+    std::vector<BalanceChange> BalanceLog::history(const Address &address) const {
+        auto run = changes(address);
+        return std::vector<BalanceChange>(run.first, run.second);
+    }
+}
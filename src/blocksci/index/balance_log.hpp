@@ -0,0 +1,64 @@
+//
+//  balance_log.hpp
+//  blocksci
+//
+
+#ifndef balance_log_hpp
+#define balance_log_hpp
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/inout_pointer.hpp>
+#include <blocksci/util/file_mapper.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace blocksci {
+    /* Optional log of every address's balance changes built by the parser. For each address type the changes of
+     * each script are stored contiguously in height order, with the script's run found through an offsets file, so
+     * the balance at a height is a binary search within the run.
+     */
+    class BalanceLog {
+    public:
+        // Offset of each script's run in the data file, holding script count + 1 values
+        static boost::filesystem::path offsetsPath(const DataConfiguration &config, AddressType::Enum type);
+        static boost::filesystem::path dataPath(const DataConfiguration &config, AddressType::Enum type);
+        
+        // Holds the number of blocks whose changes are in the log
+        static boost::filesystem::path progressPath(const DataConfiguration &config);
+        
+        explicit BalanceLog(const DataConfiguration &config);
+        
+        bool isBuilt() const {
+            return progressFile.size() == 1;
+        }
+        
+        BlockHeight blockCount() const {
+            return isBuilt() ? *progressFile.getData(0) : 0;
+        }
+        
+        // Changes of the address in blocks covered by the log, in height order
+        std::pair<const BalanceChange *, const BalanceChange *> changes(const Address &address) const;
+        
+        // Only valid for heights below blockCount()
+        uint64_t balance(const Address &address, BlockHeight height) const;
+        
+        std::vector<BalanceChange> history(const Address &address) const;
+        
+        void reload();
+        
+    private:
+        std::array<boost::filesystem::path, AddressType::size> offsetsPaths;
+        std::array<boost::filesystem::path, AddressType::size> dataPaths;
+        std::array<std::unique_ptr<FixedSizeFileMapper<uint64_t>>, AddressType::size> offsetsFiles;
+        std::array<std::unique_ptr<FixedSizeFileMapper<BalanceChange>>, AddressType::size> dataFiles;
+        FixedSizeFileMapper<BlockHeight> progressFile;
+        
+        void openTables();
+    };
+}
+
+#endif /* balance_log_hpp */
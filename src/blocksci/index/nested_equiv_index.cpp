@@ -0,0 +1,69 @@
+//
+//  nested_equiv_index.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "nested_equiv_index.hpp"
+
+#include <blocksci/address/dedup_address_info.hpp>
+#include <blocksci/util/data_configuration.hpp>
+
+namespace blocksci {
+    boost::filesystem::path NestedEquivIndex::componentsPath(const DataConfiguration &config, DedupAddressType::Enum type) {
+        return config.nestedEquivIndexDirectory()/(dedupAddressName(type) + "_components");
+    }
+    
+    boost::filesystem::path NestedEquivIndex::offsetsPath(const DataConfiguration &config) {
+        return config.nestedEquivIndexDirectory()/"offsets";
+    }
+    
+    boost::filesystem::path NestedEquivIndex::membersPath(const DataConfiguration &config) {
+        return config.nestedEquivIndexDirectory()/"members";
+    }
+    
+    boost::filesystem::path NestedEquivIndex::progressPath(const DataConfiguration &config) {
+        return config.nestedEquivIndexDirectory()/"progress";
+    }
+    
+    NestedEquivIndex::NestedEquivIndex(const DataConfiguration &config) : offsetsFilePath(offsetsPath(config)), membersFilePath(membersPath(config)), progressFile(progressPath(config)) {
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            componentsPaths[i] = componentsPath(config, static_cast<DedupAddressType::Enum>(i));
+        }
+        openTables();
+    }
+    
+    void NestedEquivIndex::openTables() {
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            componentsFiles[i] = std::make_unique<FixedSizeFileMapper<uint32_t>>(componentsPaths[i]);
+        }
+        offsetsFile = std::make_unique<FixedSizeFileMapper<uint64_t>>(offsetsFilePath);
+        membersFile = std::make_unique<FixedSizeFileMapper<DedupAddress>>(membersFilePath);
+    }
+    
+    void NestedEquivIndex::reload() {
+        // Updates replace the files rather than appending to them, so they are always reopened
+        openTables();
+        progressFile.reload();
+    }
+    
+    uint32_t NestedEquivIndex::component(const DedupAddress &address) const {
+        auto &componentsFile = *componentsFiles[static_cast<size_t>(address.type)];
+        // Scripts created after the index was built can only be linked through blocks it doesn't cover
+        if (address.scriptNum == 0 || address.scriptNum > componentsFile.size()) {
+            return 0;
+        }
+        return *componentsFile.getData(address.scriptNum - 1);
+    }
+    
+    std::pair<const DedupAddress *, const DedupAddress *> NestedEquivIndex::members(uint32_t component) const {
+        if (component == 0 || component >= offsetsFile->size()) {
+            return {nullptr, nullptr};
+        }
+        auto first = *offsetsFile->getData(component - 1);
+        auto last = *offsetsFile->getData(component);
+        auto begin = membersFile->getData(first);
+        return {begin, begin + (last - first)};
+    }
+}
@@ -0,0 +1,66 @@
+//
+//  nested_equiv_index.hpp
+//  blocksci
+//
+
+#ifndef nested_equiv_index_hpp
+#define nested_equiv_index_hpp
+
+#include <blocksci/address/dedup_address.hpp>
+#include <blocksci/address/dedup_address_type.hpp>
+#include <blocksci/util/file_mapper.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <array>
+#include <memory>
+#include <utility>
+
+namespace blocksci {
+    /* Optional index of the addresses linked by pay to script hash wrapping, built by the parser. Each dedup
+     * address type has a column holding the component of every script, with 0 for scripts that neither wrap nor
+     * are wrapped by another, and the members of each component are stored contiguously.
+     */
+    class NestedEquivIndex {
+    public:
+        static boost::filesystem::path componentsPath(const DataConfiguration &config, DedupAddressType::Enum type);
+        
+        // Offset of each component's members, holding component count + 1 values
+        static boost::filesystem::path offsetsPath(const DataConfiguration &config);
+        static boost::filesystem::path membersPath(const DataConfiguration &config);
+        
+        // Holds the number of blocks whose wrapped addresses were linked. Spending a script hash output reveals
+        // its wrapped address, so the index is only used while it covers every block
+        static boost::filesystem::path progressPath(const DataConfiguration &config);
+        
+        explicit NestedEquivIndex(const DataConfiguration &config);
+        
+        bool isBuilt() const {
+            return progressFile.size() == 1;
+        }
+        
+        BlockHeight blockCount() const {
+            return isBuilt() ? *progressFile.getData(0) : 0;
+        }
+        
+        uint32_t component(const DedupAddress &address) const;
+        
+        // Members of the component sorted by type and script number
+        std::pair<const DedupAddress *, const DedupAddress *> members(uint32_t component) const;
+        
+        void reload();
+        
+    private:
+        std::array<boost::filesystem::path, DedupAddressType::size> componentsPaths;
+        boost::filesystem::path offsetsFilePath;
+        boost::filesystem::path membersFilePath;
+        std::array<std::unique_ptr<FixedSizeFileMapper<uint32_t>>, DedupAddressType::size> componentsFiles;
+        std::unique_ptr<FixedSizeFileMapper<uint64_t>> offsetsFile;
+        std::unique_ptr<FixedSizeFileMapper<DedupAddress>> membersFile;
+        FixedSizeFileMapper<BlockHeight> progressFile;
+        
+        void openTables();
+    };
+}
+
+#endif /* nested_equiv_index_hpp */
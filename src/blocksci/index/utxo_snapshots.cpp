@@ -0,0 +1,175 @@
+//
+//  utxo_snapshots.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "utxo_snapshots.hpp"
+
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/chain/raw_block.hpp>
+#include <blocksci/chain/raw_transaction.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/parallel.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    namespace {
+        UTXOSetEntry makeEntry(const Inout &output, uint32_t txNum, uint16_t outputNum) {
+            UTXOSetEntry entry;
+            entry.value = output.getValue();
+            entry.txNum = txNum;
+            entry.scriptNum = output.toAddressNum;
+            entry.outputNum = outputNum;
+            entry.type = static_cast<uint8_t>(output.getType());
+            entry.padding = 0;
+            return entry;
+        }
+    }
+    
+    UTXOSet::UTXOSet(const std::vector<UTXOSetEntry> &entries) {
+        txNums.reserve(entries.size());
+        outputNums.reserve(entries.size());
+        values.reserve(entries.size());
+        addressTypes.reserve(entries.size());
+        scriptNums.reserve(entries.size());
+        for (auto &entry : entries) {
+            txNums.push_back(entry.txNum);
+            outputNums.push_back(entry.outputNum);
+            values.push_back(entry.value);
+            addressTypes.push_back(entry.type);
+            scriptNums.push_back(entry.scriptNum);
+        }
+    }
+    
+    boost::filesystem::path UTXOSnapshots::snapshotPath(const DataConfiguration &config, BlockHeight blockCount) {
+        return config.utxoSnapshotDirectory()/("snapshot_" + std::to_string(blockCount));
+    }
+    
+    boost::filesystem::path UTXOSnapshots::spentOffsetsPath(const DataConfiguration &config) {
+        return config.utxoSnapshotDirectory()/"spent_offsets";
+    }
+    
+    boost::filesystem::path UTXOSnapshots::spentPath(const DataConfiguration &config) {
+        return config.utxoSnapshotDirectory()/"spent";
+    }
+    
+    boost::filesystem::path UTXOSnapshots::statePath(const DataConfiguration &config) {
+        return config.utxoSnapshotDirectory()/"state";
+    }
+    
+    void UTXOSnapshots::addCreatedOutputs(const ChainAccess &chain, BlockHeight height, std::vector<UTXOSetEntry> &entries) {
+        auto block = chain.getBlock(height);
+        for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->numTxes; txNum++) {
+            auto tx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                entries.push_back(makeEntry(tx->getOutput(i), txNum, i));
+            }
+        }
+    }
+    
+    UTXOSnapshots::UTXOSnapshots(const DataConfiguration &config_) : config(config_), stateFile(statePath(config)), spentOffsetsFile(spentOffsetsPath(config)), spentFile(spentPath(config)) {}
+    
+    void UTXOSnapshots::reload() {
+        stateFile.reload();
+        spentOffsetsFile.reload();
+        spentFile.reload();
+    }
+    
+    std::vector<UTXOSetEntry> UTXOSnapshots::loadSnapshot(BlockHeight blockCount) const {
+        if (blockCount == 0) {
+            return {};
+        }
+        // Every snapshot after the first block holds at least the coinbase outputs, so an empty one is missing
+        FixedSizeFileMapper<UTXOSetEntry> snapshotFile(snapshotPath(config, blockCount));
+        if (snapshotFile.size() == 0) {
+            throw std::runtime_error("UTXO snapshot at block " + std::to_string(blockCount) + " is missing. Rerun utxo-snapshot-update with a new interval to rebuild the snapshots");
+        }
+        auto first = snapshotFile.getData(0);
+        return std::vector<UTXOSetEntry>(first, first + snapshotFile.size());
+    }
+    
+    void UTXOSnapshots::replay(std::vector<UTXOSetEntry> &entries, BlockHeight begin, BlockHeight end, const ChainAccess &chain) const {
+        if (end <= begin) {
+            return;
+        }
+        if (static_cast<size_t>(end) >= spentOffsetsFile.size()) {
+            throw std::out_of_range("Block is not covered by the UTXO spent log");
+        }
+        
+        // New outputs have higher tx numbers than everything in the set, so appending them keeps it sorted
+        for (auto height = begin; height < end; height++) {
+            addCreatedOutputs(chain, height, entries);
+        }
+        
+        auto firstSpent = *spentOffsetsFile.getData(static_cast<size_t>(begin));
+        auto lastSpent = *spentOffsetsFile.getData(static_cast<size_t>(end));
+        if (firstSpent == lastSpent) {
+            return;
+        }
+        std::vector<OutputPointer> spent(spentFile.getData(firstSpent), spentFile.getData(firstSpent) + (lastSpent - firstSpent));
+        std::sort(spent.begin(), spent.end());
+        
+        // Both are sorted by output pointer, so one pass drops the spent outputs
+        auto spentIt = spent.begin();
+        size_t keptCount = 0;
+        for (auto &entry : entries) {
+            auto pointer = entry.pointer();
+            while (spentIt != spent.end() && *spentIt < pointer) {
+                ++spentIt;
+            }
+            if (spentIt == spent.end() || *spentIt != pointer) {
+                entries[keptCount++] = entry;
+            }
+        }
+        entries.resize(keptCount);
+    }
+    
+    std::vector<UTXOSetEntry> UTXOSnapshots::entries(BlockHeight height, const ChainAccess &chain) const {
+        auto count = height + 1;
+        if (height < 0 || count > blockCount()) {
+            throw std::out_of_range("Block is not covered by the UTXO snapshots");
+        }
+        auto base = count - count % static_cast<BlockHeight>(interval());
+        auto entries = loadSnapshot(base);
+        replay(entries, base, count, chain);
+        return entries;
+    }
+    
+    UTXOSet getUTXOSet(BlockHeight height, const DataAccess &access) {
+        auto &chain = *access.chain;
+        if (height < 0 || height >= chain.blockCount()) {
+            throw std::out_of_range("Block height out of range");
+        }
+        auto &snapshots = *access.utxoSnapshots;
+        if (snapshots.isBuilt() && height < snapshots.blockCount()) {
+            return UTXOSet{snapshots.entries(height, chain)};
+        }
+        
+        auto lastBlock = chain.getBlock(height);
+        auto txEnd = lastBlock->firstTxIndex + lastBlock->numTxes;
+        auto accumulate = [&](std::vector<UTXOSetEntry> &entries, uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (auto txNum = chunkBegin; txNum < chunkEnd; txNum++) {
+                auto tx = chain.getTx(static_cast<uint32_t>(txNum));
+                for (uint16_t i = 0; i < tx->outputCount; i++) {
+                    auto &output = tx->getOutput(i);
+                    // Outputs spent in ignored blocks count as unspent, as in isSpentRaw
+                    auto spent = output.linkedTxNum != 0 && output.linkedTxNum < chain.maxLoadedTx();
+                    if (spent && chain.getBlockHeight(output.linkedTxNum) <= height) {
+                        continue;
+                    }
+                    entries.push_back(makeEntry(output, static_cast<uint32_t>(txNum), i));
+                }
+            }
+        };
+        auto combine = [](std::vector<UTXOSetEntry> &entries, std::vector<UTXOSetEntry> &chunkEntries) {
+            entries.insert(entries.end(), chunkEntries.begin(), chunkEntries.end());
+        };
+        auto entries = parallelReduceChunks(getThreadPool(access.config.threadCount), 0, txEnd, std::vector<UTXOSetEntry>{}, accumulate, combine);
+        return UTXOSet{entries};
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  utxo_snapshots.hpp
+//  blocksci
+//
+
+#ifndef utxo_snapshots_hpp
+#define utxo_snapshots_hpp
+
+#include <blocksci/address/address_types.hpp>
+#include <blocksci/chain/inout_pointer.hpp>
+#include <blocksci/util/data_configuration.hpp>
+#include <blocksci/util/file_mapper.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <vector>
+
+namespace blocksci {
+    class ChainAccess;
+    
+    struct UTXOSetEntry {
+        uint64_t value;
+        uint32_t txNum;
+        uint32_t scriptNum;
+        uint16_t outputNum;
+        uint8_t type;
+        uint8_t padding;
+        
+        OutputPointer pointer() const {
+            return {txNum, outputNum};
+        }
+    };
+    
+    // Columns of a UTXO set, sorted by output pointer
+    struct UTXOSet {
+        std::vector<uint32_t> txNums;
+        std::vector<uint16_t> outputNums;
+        std::vector<uint64_t> values;
+        std::vector<uint8_t> addressTypes;
+        std::vector<uint32_t> scriptNums;
+        
+        UTXOSet() = default;
+        explicit UTXOSet(const std::vector<UTXOSetEntry> &entries);
+        
+        size_t size() const {
+            return txNums.size();
+        }
+    };
+    
+    /* Optional UTXO set snapshots built by the parser. The set after every interval blocks is stored sorted by
+     * output pointer, and a log records the outputs spent in each block. Outputs created by a block are read from
+     * the chain, so the set after any covered block is the nearest earlier snapshot with at most interval - 1 blocks
+     * replayed on top of it.
+     */
+    class UTXOSnapshots {
+    public:
+        // Snapshot of the UTXO set after the first blockCount blocks
+        static boost::filesystem::path snapshotPath(const DataConfiguration &config, BlockHeight blockCount);
+        
+        // Offset into the spent log of each block's run, holding block count + 1 values
+        static boost::filesystem::path spentOffsetsPath(const DataConfiguration &config);
+        static boost::filesystem::path spentPath(const DataConfiguration &config);
+        
+        // Holds the number of blocks covered followed by the snapshot interval
+        static boost::filesystem::path statePath(const DataConfiguration &config);
+        
+        static void addCreatedOutputs(const ChainAccess &chain, BlockHeight height, std::vector<UTXOSetEntry> &entries);
+        
+        explicit UTXOSnapshots(const DataConfiguration &config);
+        
+        bool isBuilt() const {
+            return stateFile.size() == 2;
+        }
+        
+        BlockHeight blockCount() const {
+            return isBuilt() ? static_cast<BlockHeight>(*stateFile.getData(0)) : 0;
+        }
+        
+        uint32_t interval() const {
+            return isBuilt() ? *stateFile.getData(1) : 0;
+        }
+        
+        // The set is empty for a block count of 0. Throws std::runtime_error if any other snapshot is missing
+        std::vector<UTXOSetEntry> loadSnapshot(BlockHeight blockCount) const;
+        
+        // Applies blocks [begin, end) to entries, which must hold the set after the first begin blocks
+        void replay(std::vector<UTXOSetEntry> &entries, BlockHeight begin, BlockHeight end, const ChainAccess &chain) const;
+        
+        // Set after the block at height has been applied. The height must be below blockCount()
+        std::vector<UTXOSetEntry> entries(BlockHeight height, const ChainAccess &chain) const;
+        
+        void reload();
+        
+    private:
+        DataConfiguration config;
+        FixedSizeFileMapper<uint32_t> stateFile;
+        FixedSizeFileMapper<uint64_t> spentOffsetsFile;
+        FixedSizeFileMapper<OutputPointer> spentFile;
+    };
+    
+    class DataAccess;
+    
+    // Uses the snapshots when they cover the height and otherwise scans every output up to it
+    UTXOSet getUTXOSet(BlockHeight height, const DataAccess &access);
+}
+
+#endif /* utxo_snapshots_hpp */
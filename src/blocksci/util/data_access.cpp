@@ -15,12 +15,21 @@
 #include <blocksci/chain/output.hpp>
 #include <blocksci/index/address_index.hpp>
 #include <blocksci/index/hash_index.hpp>
+#include <blocksci/index/address_prefix_index.hpp>
+#include <blocksci/index/balance_log.hpp>
+#include <blocksci/index/utxo_snapshots.hpp>
+#include <blocksci/index/nested_equiv_index.hpp>
 
 #include <unordered_set>
 
 namespace blocksci {
     
-    DataAccess::DataAccess(const DataConfiguration &config_) : config(config_), chain{std::make_unique<ChainAccess>(config)}, scripts{std::make_unique<ScriptAccess>(config)}, addressIndex{std::make_unique<AddressIndex>(config.addressDBFilePath().native(), true)}, hashIndex{std::make_unique<HashIndex>(config.hashIndexFilePath().native(), true)} {}
+    DataAccess::DataAccess(const DataConfiguration &config_) : config(config_), chain{std::make_unique<ChainAccess>(config)}, scripts{std::make_unique<ScriptAccess>(config)}, addressIndex{std::make_unique<AddressIndex>(config.addressDBFilePath().native(), true)}, hashIndex{std::make_unique<HashIndex>(config.hashIndexFilePath().native(), true)}, prefixIndex{std::make_unique<AddressPrefixIndex>(config)}, balanceLog{std::make_unique<BalanceLog>(config)}, utxoSnapshots{std::make_unique<UTXOSnapshots>(config)}, nestedEquivIndex{std::make_unique<NestedEquivIndex>(config)} {}
+    
+    DataAccess::DataAccess() = default;
+    DataAccess::DataAccess(DataAccess &&) = default;
+    DataAccess &DataAccess::operator=(DataAccess &&) = default;
+    DataAccess::~DataAccess() = default;
 }
 
 
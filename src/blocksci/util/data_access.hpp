@@ -16,6 +16,10 @@
 
 namespace blocksci {
     class AddressIndex;
+    class AddressPrefixIndex;
+    class BalanceLog;
+    class UTXOSnapshots;
+    class NestedEquivIndex;
 
     class DataAccess {
     public:
@@ -24,9 +28,17 @@ namespace blocksci {
         std::unique_ptr<ScriptAccess> scripts;
         std::unique_ptr<AddressIndex> addressIndex;
         std::unique_ptr<HashIndex> hashIndex;
+        std::unique_ptr<AddressPrefixIndex> prefixIndex;
+        std::unique_ptr<BalanceLog> balanceLog;
+        std::unique_ptr<UTXOSnapshots> utxoSnapshots;
+        std::unique_ptr<NestedEquivIndex> nestedEquivIndex;
         
-        DataAccess() = default;
+        DataAccess();
         DataAccess(const DataConfiguration &config);
+        DataAccess(DataAccess &&);
+        DataAccess &operator=(DataAccess &&);
+        // Defined with the index types complete so that users don't need their headers
+        ~DataAccess();
         
         operator DataConfiguration() const { return config; }
     };
@@ -30,6 +30,9 @@ namespace blocksci {
         bool errorOnReorg;
         BlockHeight blocksIgnored;
         
+        // Threads used by parallel queries. 0 uses BLOCKSCI_THREADS if set, otherwise the hardware concurrency
+        unsigned int threadCount = 0;
+        
         std::vector<unsigned char> pubkeyPrefix;
         std::vector<unsigned char> scriptPrefix;
         std::string segwitPrefix;
@@ -56,6 +59,26 @@ namespace blocksci {
             return chainDirectory()/"tx_hashes";
         }
         
+        boost::filesystem::path txHeightsFilePath() const {
+            return chainDirectory()/"tx_heights";
+        }
+        
+        boost::filesystem::path txFeesFilePath() const {
+            return chainDirectory()/"tx_fees";
+        }
+        
+        boost::filesystem::path txInputValuesFilePath() const {
+            return chainDirectory()/"tx_input_values";
+        }
+        
+        boost::filesystem::path txOutputValuesFilePath() const {
+            return chainDirectory()/"tx_output_values";
+        }
+        
+        boost::filesystem::path chainEpochFilePath() const {
+            return chainDirectory()/"epoch";
+        }
+        
         boost::filesystem::path blockFilePath() const {
             return chainDirectory()/"block";
         }
@@ -68,10 +91,38 @@ namespace blocksci {
             return chainDirectory()/"sequence";
         }
         
+        boost::filesystem::path sparseSequenceFilePath() const {
+            return chainDirectory()/"sequence_sparse";
+        }
+        
+        boost::filesystem::path spendingInputFilePath() const {
+            return chainDirectory()/"spending_input";
+        }
+        
+        boost::filesystem::path blockStatsFilePath() const {
+            return chainDirectory()/"block_stats";
+        }
+        
         boost::filesystem::path addressDBFilePath() const {
             return dataDirectory/"addressesDb";
         }
         
+        boost::filesystem::path addressPrefixIndexDirectory() const {
+            return dataDirectory/"addressPrefixIndex";
+        }
+        
+        boost::filesystem::path balanceLogDirectory() const {
+            return dataDirectory/"balanceLog";
+        }
+        
+        boost::filesystem::path utxoSnapshotDirectory() const {
+            return dataDirectory/"utxoSnapshots";
+        }
+        
+        boost::filesystem::path nestedEquivIndexDirectory() const {
+            return dataDirectory/"nestedEquivIndex";
+        }
+        
         boost::filesystem::path hashIndexFilePath() const {
             return dataDirectory/"hashIndex";
         }
@@ -25,4 +25,8 @@ blocksci::uint160 hash160(const void *data, unsigned long len);
 
 bool base58_sha256(void *digest, const void *data, size_t datasz);
 
+// Hash count independent messages, using multi-buffer SIMD hashing when it is faster than OpenSSL on this CPU
+void sha256Batch(const unsigned char * const *messages, const size_t *lengths, blocksci::uint256 *hashes, size_t count);
+void doubleSha256Batch(const unsigned char * const *messages, const size_t *lengths, blocksci::uint256 *hashes, size_t count);
+
 #endif /* hash_hpp */
@@ -8,56 +8,103 @@
 #ifndef parallel_hpp
 #define parallel_hpp
 
-#include <blocksci/chain/chain_fwd.hpp>
+#include "thread_pool.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 #include <vector>
-#include <future>
-#include <thread>
-#include <functional>
-#include <stdio.h>
+
+/* Parallel loops over index ranges such as transaction numbers, block heights or script numbers. The range is
+ * split into parallelChunksPerThread chunks per pool thread and each chunk runs as one pool task. The loop body
+ * is a template parameter invoked directly inside the chunk loop, so type erasure only happens once per chunk.
+ */
 
 namespace blocksci {
-    
-    template <typename It, typename MapType, typename ResultType>
-    ResultType mapReduceTransactionsImp(It begin, It end, const std::function<MapType(const std::vector<Block> &)> &mapFunc, const std::function<ResultType&(ResultType &, MapType &)> &reduceFunc, ResultType identity) {
-        auto segmentCount = std::distance(begin, end);
-        if(segmentCount == 1) {
-            ResultType res = identity;
-            auto ret = mapFunc(*begin);
-            res = reduceFunc(res, ret);
-            return res;
-        } else {
-            auto mid = begin;
-            std::advance(mid, segmentCount / 2);
-            auto handle = std::async(std::launch::async, mapReduceTransactionsImp<It, MapType, ResultType>, begin, mid, mapFunc, reduceFunc, identity);
-            ResultType res = identity;
-            auto ret1 = mapReduceBlocksImp(mid, end, mapFunc, reduceFunc, identity);
-            res = reduceFunc(res, ret1);
-            auto ret2 = handle.get();
-            res = reduceFunc(res, ret2);
-            return res;
+
+    constexpr unsigned int parallelChunksPerThread = 16;
+
+    inline uint64_t parallelChunkCount(const ThreadPool &pool, uint64_t itemCount) {
+        return std::min<uint64_t>(itemCount, uint64_t{pool.size()} * parallelChunksPerThread);
+    }
+
+    namespace detail {
+        template <typename Func>
+        void forEachChunk(ThreadPool &pool, uint64_t begin, uint64_t end, uint64_t chunkCount, Func &func) {
+            auto total = end - begin;
+            pool.parallelFor(chunkCount, [&](size_t chunk) {
+                func(chunk, begin + total * chunk / chunkCount, begin + total * (chunk + 1) / chunkCount);
+            });
+        }
+    }
+
+    // Calls func(chunkBegin, chunkEnd) for disjoint chunks covering [begin, end)
+    template <typename Func>
+    void parallelForChunks(ThreadPool &pool, uint64_t begin, uint64_t end, Func &&func) {
+        if (end <= begin) {
+            return;
         }
+        auto chunkFunc = [&](uint64_t, uint64_t chunkBegin, uint64_t chunkEnd) {
+            func(chunkBegin, chunkEnd);
+        };
+        detail::forEachChunk(pool, begin, end, parallelChunkCount(pool, end - begin), chunkFunc);
     }
-    
-    template <typename It, typename MapType, typename ResultType>
-    ResultType mapReduceBlocksImp(It begin, It end, const std::function<MapType(const std::vector<Block> &)> &mapFunc, const std::function<ResultType&(ResultType &, MapType &)> &reduceFunc, ResultType identity) {
-        auto segmentCount = std::distance(begin, end);
-        if(segmentCount == 1) {
-            ResultType res = identity;
-            auto ret = mapFunc(*begin);
-            res = reduceFunc(res, ret);
-            return res;
-        } else {
-            auto mid = begin;
-            std::advance(mid, segmentCount / 2);
-            auto handle = std::async(std::launch::async, mapReduceBlocksImp<It, MapType, ResultType>, begin, mid, mapFunc, reduceFunc, identity);
-            ResultType res = identity;
-            auto ret1 = mapReduceBlocksImp(mid, end, mapFunc, reduceFunc, identity);
-            res = reduceFunc(res, ret1);
-            auto ret2 = handle.get();
-            res = reduceFunc(res, ret2);
-            return res;
+
+    // Calls func(i) for every i in [begin, end)
+    template <typename Func>
+    void parallelFor(ThreadPool &pool, uint64_t begin, uint64_t end, Func &&func) {
+        parallelForChunks(pool, begin, end, [&](uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (uint64_t i = chunkBegin; i < chunkEnd; i++) {
+                func(i);
+            }
+        });
+    }
+
+    // Sets out[i - begin] = func(i) for every i in [begin, end). out must already hold end - begin elements
+    template <typename OutputIt, typename Func>
+    void parallelCollect(ThreadPool &pool, uint64_t begin, uint64_t end, OutputIt out, Func &&func) {
+        parallelForChunks(pool, begin, end, [&](uint64_t chunkBegin, uint64_t chunkEnd) {
+            auto chunkOut = out + static_cast<std::ptrdiff_t>(chunkBegin - begin);
+            for (uint64_t i = chunkBegin; i < chunkEnd; i++) {
+                *chunkOut = func(i);
+                ++chunkOut;
+            }
+        });
+    }
+
+    /* Each chunk starts from a copy of identity and folds its part of the range in with
+     * accumulate(acc, chunkBegin, chunkEnd). The chunk results are then merged in index order with combine(total, acc)
+     */
+    template <typename T, typename AccumulateFunc, typename CombineFunc>
+    T parallelReduceChunks(ThreadPool &pool, uint64_t begin, uint64_t end, const T &identity, AccumulateFunc &&accumulate, CombineFunc &&combine) {
+        if (end <= begin) {
+            return identity;
+        }
+        auto chunkCount = parallelChunkCount(pool, end - begin);
+        std::vector<T> accumulators(chunkCount, identity);
+        auto chunkFunc = [&](uint64_t chunk, uint64_t chunkBegin, uint64_t chunkEnd) {
+            // Accumulate into a local so that neighbouring chunks don't share cache lines
+            T acc = identity;
+            accumulate(acc, chunkBegin, chunkEnd);
+            accumulators[chunk] = std::move(acc);
+        };
+        detail::forEachChunk(pool, begin, end, chunkCount, chunkFunc);
+        T total = identity;
+        for (auto &acc : accumulators) {
+            combine(total, acc);
         }
+        return total;
+    }
+
+    // Same as parallelReduceChunks with accumulate(acc, i) called for every index
+    template <typename T, typename AccumulateFunc, typename CombineFunc>
+    T parallelReduce(ThreadPool &pool, uint64_t begin, uint64_t end, const T &identity, AccumulateFunc &&accumulate, CombineFunc &&combine) {
+        return parallelReduceChunks(pool, begin, end, identity, [&](T &acc, uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (uint64_t i = chunkBegin; i < chunkEnd; i++) {
+                accumulate(acc, i);
+            }
+        }, combine);
     }
 }
 
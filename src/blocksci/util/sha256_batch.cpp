@@ -0,0 +1,253 @@
+//
+//  sha256_batch.cpp
+//  blocksci
+//
+
+#include "util/hash.hpp"
+
+#include <openssl/sha.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define BLOCKSCI_SHA256_MULTI_BUFFER
+#endif
+
+#include <cstring>
+#include <vector>
+
+namespace {
+    void sha256BatchOpenSSL(const unsigned char * const *messages, const size_t *lengths, unsigned char *digests, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            SHA256(messages[i], lengths[i], digests + 32 * i);
+        }
+    }
+
+#ifdef BLOCKSCI_SHA256_MULTI_BUFFER
+
+    /* Multi-buffer SHA-256 runs one independent message in each 32 bit lane of a vector register. The round
+     * function is written with GCC vector extensions so that the same code compiles to 4 lanes of SSE2 and,
+     * inside a function targeted at AVX2, 8 lanes of AVX2.
+     */
+
+    typedef uint32_t u32x4 __attribute__((vector_size(16)));
+    typedef uint32_t u32x8 __attribute__((vector_size(32)));
+
+    constexpr uint32_t roundConstants[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    constexpr uint32_t initialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    inline uint32_t readBE32(const unsigned char *ptr) {
+        return (static_cast<uint32_t>(ptr[0]) << 24) | (static_cast<uint32_t>(ptr[1]) << 16) | (static_cast<uint32_t>(ptr[2]) << 8) | static_cast<uint32_t>(ptr[3]);
+    }
+
+    inline void writeBE32(unsigned char *ptr, uint32_t x) {
+        ptr[0] = static_cast<unsigned char>(x >> 24);
+        ptr[1] = static_cast<unsigned char>(x >> 16);
+        ptr[2] = static_cast<unsigned char>(x >> 8);
+        ptr[3] = static_cast<unsigned char>(x);
+    }
+
+    // A macro rather than a function so that 32 byte vectors are never passed by value outside of AVX2 code
+#define BLOCKSCI_SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+    template <typename V, size_t Lanes>
+    __attribute__((always_inline)) inline void transformLanes(V state[8], const unsigned char *const blocks[Lanes]) {
+        V w[16];
+        for (int i = 0; i < 16; i++) {
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                w[i][lane] = readBE32(blocks[lane] + 4 * i);
+            }
+        }
+
+        V a = state[0], b = state[1], c = state[2], d = state[3];
+        V e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++) {
+            V wi;
+            if (i < 16) {
+                wi = w[i];
+            } else {
+                V w15 = w[(i - 15) & 15];
+                V w2 = w[(i - 2) & 15];
+                V s0 = BLOCKSCI_SHA256_ROTR(w15, 7) ^ BLOCKSCI_SHA256_ROTR(w15, 18) ^ (w15 >> 3);
+                V s1 = BLOCKSCI_SHA256_ROTR(w2, 17) ^ BLOCKSCI_SHA256_ROTR(w2, 19) ^ (w2 >> 10);
+                wi = w[i & 15] + s0 + w[(i - 7) & 15] + s1;
+                w[i & 15] = wi;
+            }
+            V t1 = h + (BLOCKSCI_SHA256_ROTR(e, 6) ^ BLOCKSCI_SHA256_ROTR(e, 11) ^ BLOCKSCI_SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + roundConstants[i] + wi;
+            V t2 = (BLOCKSCI_SHA256_ROTR(a, 2) ^ BLOCKSCI_SHA256_ROTR(a, 13) ^ BLOCKSCI_SHA256_ROTR(a, 22)) + ((a & b) | (c & (a | b)));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+#undef BLOCKSCI_SHA256_ROTR
+
+    // Tracks the message assigned to one lane, including its padded final block(s)
+    struct Lane {
+        const unsigned char *data;
+        size_t fullBlocks;
+        size_t totalBlocks;
+        size_t currentBlock;
+        size_t messageNum;
+        bool active;
+        unsigned char tail[128];
+
+        void assign(const unsigned char *message, size_t length, size_t messageNum_) {
+            data = message;
+            messageNum = messageNum_;
+            fullBlocks = length / 64;
+            size_t remaining = length % 64;
+            size_t tailBlocks = remaining + 9 <= 64 ? 1 : 2;
+            totalBlocks = fullBlocks + tailBlocks;
+            currentBlock = 0;
+            active = true;
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, message + fullBlocks * 64, remaining);
+            tail[remaining] = 0x80;
+            uint64_t bitLength = static_cast<uint64_t>(length) * 8;
+            unsigned char *lengthPos = tail + tailBlocks * 64 - 8;
+            writeBE32(lengthPos, static_cast<uint32_t>(bitLength >> 32));
+            writeBE32(lengthPos + 4, static_cast<uint32_t>(bitLength));
+        }
+
+        const unsigned char *block() const {
+            if (currentBlock < fullBlocks) {
+                return data + currentBlock * 64;
+            } else {
+                return tail + (currentBlock - fullBlocks) * 64;
+            }
+        }
+    };
+
+    template <typename V, size_t Lanes>
+    __attribute__((always_inline)) inline void sha256MultiBuffer(const unsigned char * const *messages, const size_t *lengths, unsigned char *digests, size_t count) {
+        static const unsigned char idleBlock[64] = {};
+        Lane lanes[Lanes];
+        V state[8];
+        size_t nextMessage = 0;
+        size_t activeLanes = 0;
+
+        auto startMessage = [&](size_t laneNum) {
+            auto &lane = lanes[laneNum];
+            if (nextMessage < count) {
+                lane.assign(messages[nextMessage], lengths[nextMessage], nextMessage);
+                for (int j = 0; j < 8; j++) {
+                    state[j][laneNum] = initialState[j];
+                }
+                nextMessage++;
+                activeLanes++;
+            } else {
+                lane.active = false;
+            }
+        };
+
+        for (size_t laneNum = 0; laneNum < Lanes; laneNum++) {
+            startMessage(laneNum);
+        }
+
+        const unsigned char *blocks[Lanes];
+        while (activeLanes > 0) {
+            for (size_t laneNum = 0; laneNum < Lanes; laneNum++) {
+                blocks[laneNum] = lanes[laneNum].active ? lanes[laneNum].block() : idleBlock;
+            }
+
+            transformLanes<V, Lanes>(state, blocks);
+
+            for (size_t laneNum = 0; laneNum < Lanes; laneNum++) {
+                auto &lane = lanes[laneNum];
+                if (!lane.active) {
+                    continue;
+                }
+                lane.currentBlock++;
+                if (lane.currentBlock == lane.totalBlocks) {
+                    unsigned char *digest = digests + 32 * lane.messageNum;
+                    for (int j = 0; j < 8; j++) {
+                        writeBE32(digest + 4 * j, state[j][laneNum]);
+                    }
+                    activeLanes--;
+                    startMessage(laneNum);
+                }
+            }
+        }
+    }
+
+    void sha256BatchSSE2(const unsigned char * const *messages, const size_t *lengths, unsigned char *digests, size_t count) {
+        sha256MultiBuffer<u32x4, 4>(messages, lengths, digests, count);
+    }
+
+    __attribute__((target("avx2")))
+    void sha256BatchAVX2(const unsigned char * const *messages, const size_t *lengths, unsigned char *digests, size_t count) {
+        sha256MultiBuffer<u32x8, 8>(messages, lengths, digests, count);
+    }
+
+    bool hasShaExtensions() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ebx & (1u << 29)) != 0;
+    }
+
+#endif
+
+    using Sha256BatchFunc = void (*)(const unsigned char * const *, const size_t *, unsigned char *, size_t);
+
+    Sha256BatchFunc selectSha256Batch() {
+#ifdef BLOCKSCI_SHA256_MULTI_BUFFER
+        // 8 lane AVX2 beats OpenSSL even when OpenSSL can use the SHA extensions. 4 lane SSE2 only beats OpenSSL without them
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return sha256BatchAVX2;
+        }
+        if (hasShaExtensions()) {
+            return sha256BatchOpenSSL;
+        }
+        return sha256BatchSSE2;
+#else
+        return sha256BatchOpenSSL;
+#endif
+    }
+
+    Sha256BatchFunc getSha256Batch() {
+        static const Sha256BatchFunc func = selectSha256Batch();
+        return func;
+    }
+}
+
+void sha256Batch(const unsigned char * const *messages, const size_t *lengths, blocksci::uint256 *hashes, size_t count) {
+    static_assert(sizeof(blocksci::uint256) == 32, "Hashes are written contiguously");
+    getSha256Batch()(messages, lengths, reinterpret_cast<unsigned char *>(hashes), count);
+}
+
+void doubleSha256Batch(const unsigned char * const *messages, const size_t *lengths, blocksci::uint256 *hashes, size_t count) {
+    sha256Batch(messages, lengths, hashes, count);
+
+    std::vector<const unsigned char *> firstHashes(count);
+    std::vector<size_t> firstHashLengths(count, sizeof(blocksci::uint256));
+    for (size_t i = 0; i < count; i++) {
+        firstHashes[i] = hashes[i].begin();
+    }
+    // 32 byte messages are copied into their lane's padding buffer when assigned, so hashing in place is safe
+    sha256Batch(firstHashes.data(), firstHashLengths.data(), hashes, count);
+}
@@ -0,0 +1,207 @@
+//
+//  thread_pool.cpp
+//  blocksci
+//
+
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace blocksci {
+    namespace {
+        thread_local ThreadPool *currentPool = nullptr;
+        thread_local size_t currentWorker = 0;
+    }
+
+    struct ThreadPool::TaskGroup {
+        const std::function<void(size_t)> *func;
+        // Only decremented while holding m so that the waiting thread can't destroy the group under a finishing task
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex m;
+        std::condition_variable cv;
+
+        TaskGroup(const std::function<void(size_t)> *func_, size_t count) : func(func_), remaining(count) {}
+    };
+
+    ThreadPool::ThreadPool(unsigned int threadCount) {
+        size_t workerCount = threadCount > 1 ? threadCount - 1 : 0;
+        for (size_t i = 0; i < workerCount; i++) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCV.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::popTask(size_t queueNum, Task &task) {
+        auto &queue = *queues[queueNum];
+        std::lock_guard<std::mutex> lock(queue.m);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        queuedTasks--;
+        return true;
+    }
+
+    bool ThreadPool::stealTask(size_t thiefNum, Task &task) {
+        for (size_t i = 1; i <= queues.size(); i++) {
+            auto &queue = *queues[(thiefNum + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.m);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                queuedTasks--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::findTask(Task &task) {
+        if (queuedTasks.load() == 0) {
+            return false;
+        }
+        if (currentPool == this) {
+            return popTask(currentWorker, task) || stealTask(currentWorker, task);
+        }
+        return stealTask(nextQueue.fetch_add(1), task);
+    }
+
+    void ThreadPool::runTask(const Task &task) {
+        auto &group = *task.group;
+        if (!group.failed.load()) {
+            try {
+                (*group.func)(task.index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(group.m);
+                if (!group.error) {
+                    group.error = std::current_exception();
+                }
+                group.failed = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(group.m);
+        if (--group.remaining == 0) {
+            group.cv.notify_all();
+        }
+    }
+
+    void ThreadPool::workerLoop(size_t workerNum) {
+        currentPool = this;
+        currentWorker = workerNum;
+        Task task;
+        while (true) {
+            if (findTask(task)) {
+                runTask(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCV.wait(lock, [&]() {
+                return stopping || queuedTasks.load() > 0;
+            });
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &func) {
+        if (count == 0) {
+            return;
+        }
+        if (workers.empty() || count == 1) {
+            for (size_t i = 0; i < count; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        TaskGroup group(&func, count);
+        if (currentPool == this) {
+            // Nested call from a worker. Keep the tasks local and let idle workers steal them
+            auto &queue = *queues[currentWorker];
+            std::lock_guard<std::mutex> lock(queue.m);
+            for (size_t i = 0; i < count; i++) {
+                queue.tasks.push_back(Task{&group, i});
+            }
+            queuedTasks += count;
+        } else {
+            auto firstQueue = nextQueue.fetch_add(1);
+            for (size_t i = 0; i < count; i++) {
+                auto &queue = *queues[(firstQueue + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(queue.m);
+                queue.tasks.push_back(Task{&group, i});
+                queuedTasks++;
+            }
+        }
+        {
+            // Workers check queuedTasks while holding sleepMutex, so taking it here prevents a lost wakeup
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCV.notify_all();
+
+        Task task;
+        while (group.remaining.load() > 0) {
+            if (findTask(task)) {
+                runTask(task);
+                continue;
+            }
+            // Our remaining tasks are running elsewhere, but they may queue nested work that we can help with
+            std::unique_lock<std::mutex> lock(group.m);
+            group.cv.wait_for(lock, std::chrono::milliseconds(1), [&]() {
+                return group.remaining.load() == 0;
+            });
+        }
+
+        std::lock_guard<std::mutex> lock(group.m);
+        if (group.error) {
+            std::rethrow_exception(group.error);
+        }
+    }
+
+    unsigned int defaultThreadCount() {
+        if (auto value = std::getenv("BLOCKSCI_THREADS")) {
+            char *end;
+            auto count = std::strtol(value, &end, 10);
+            if (end == value || *end != '\0' || count <= 0) {
+                throw std::runtime_error("BLOCKSCI_THREADS must be a positive integer");
+            }
+            return static_cast<unsigned int>(count);
+        }
+        auto hardwareCount = std::thread::hardware_concurrency();
+        return hardwareCount > 0 ? hardwareCount : 1;
+    }
+
+    ThreadPool &getThreadPool(unsigned int threadCount) {
+        static std::mutex poolsMutex;
+        static std::unordered_map<unsigned int, std::unique_ptr<ThreadPool>> pools;
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        std::lock_guard<std::mutex> lock(poolsMutex);
+        auto &pool = pools[threadCount];
+        if (!pool) {
+            pool = std::make_unique<ThreadPool>(threadCount);
+        }
+        return *pool;
+    }
+}
@@ -0,0 +1,75 @@
+//
+//  thread_pool.hpp
+//  blocksci
+//
+
+#ifndef thread_pool_hpp
+#define thread_pool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blocksci {
+
+    /* Persistent work stealing thread pool. Each worker owns a deque of tasks which it runs newest first while
+     * idle workers steal the oldest tasks from the others. A thread waiting on parallelFor runs queued tasks
+     * instead of blocking, so nested calls from inside a task share the same workers rather than spawning more.
+     */
+    class ThreadPool {
+        struct TaskGroup;
+
+        struct Task {
+            TaskGroup *group;
+            size_t index;
+        };
+
+        struct WorkerQueue {
+            std::mutex m;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queuedTasks{0};
+        std::atomic<size_t> nextQueue{0};
+        std::mutex sleepMutex;
+        std::condition_variable sleepCV;
+        bool stopping = false;
+
+        bool popTask(size_t queueNum, Task &task);
+        bool stealTask(size_t thiefNum, Task &task);
+        bool findTask(Task &task);
+        void runTask(const Task &task);
+        void workerLoop(size_t workerNum);
+
+    public:
+        // The calling thread counts towards threadCount, so a pool of one thread runs everything inline
+        explicit ThreadPool(unsigned int threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        unsigned int size() const {
+            return static_cast<unsigned int>(workers.size() + 1);
+        }
+
+        // Runs func(i) for every i in [0, count) and returns once all have finished, rethrowing the first exception
+        void parallelFor(size_t count, const std::function<void(size_t)> &func);
+    };
+
+    // Value of the BLOCKSCI_THREADS environment variable if set, otherwise the hardware concurrency
+    unsigned int defaultThreadCount();
+
+    // Shared pool with the given number of threads, created on first use. 0 selects defaultThreadCount()
+    ThreadPool &getThreadPool(unsigned int threadCount = 0);
+}
+
+#endif /* thread_pool_hpp */
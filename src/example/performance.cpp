@@ -8,6 +8,14 @@
 
 #include "performance.hpp"
 
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/hash.hpp>
+#include <blocksci/index/utxo_snapshots.hpp>
+
+#include <range/v3/distance.hpp>
+
+#include <algorithm>
+
 using namespace blocksci;
 
 std::vector<uint64_t> unspentSums1(Blockchain &chain, uint32_t start, uint32_t stop) {
@@ -135,3 +143,226 @@ uint64_t maxValOutput2(Blockchain &chain, uint32_t start, uint32_t stop) {
     
     return chain.mapReduce<uint64_t>(start, stop, extract, combine);
 }
+
+// Builds a message per transaction with the same length as its hashed serialization
+static std::vector<std::vector<unsigned char>> txSizedMessages(Blockchain &chain, uint32_t start, uint32_t stop) {
+    std::vector<std::vector<unsigned char>> messages;
+    for (uint32_t height = start; height < stop; height++) {
+        RANGES_FOR(auto tx, chain[height]) {
+            auto hash = tx.getHash();
+            std::vector<unsigned char> message(tx.baseSize());
+            for (size_t i = 0; i < message.size(); i++) {
+                message[i] = hash.begin()[i % sizeof(hash)];
+            }
+            messages.push_back(std::move(message));
+        }
+    }
+    return messages;
+}
+
+std::vector<uint256> txSizedHashes1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto messages = txSizedMessages(chain, start, stop);
+    std::vector<uint256> hashes;
+    hashes.reserve(messages.size());
+    for (auto &message : messages) {
+        hashes.push_back(doubleSha256(reinterpret_cast<const char *>(message.data()), message.size()));
+    }
+    return hashes;
+}
+
+std::vector<uint256> txSizedHashes2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto messages = txSizedMessages(chain, start, stop);
+    std::vector<const unsigned char *> messagePtrs;
+    std::vector<size_t> lengths;
+    messagePtrs.reserve(messages.size());
+    lengths.reserve(messages.size());
+    for (auto &message : messages) {
+        messagePtrs.push_back(message.data());
+        lengths.push_back(message.size());
+    }
+    std::vector<uint256> hashes(messages.size());
+    doubleSha256Batch(messagePtrs.data(), lengths.data(), hashes.data(), hashes.size());
+    return hashes;
+}
+
+size_t pubkeyHashStringsLength1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    size_t total = 0;
+    for (uint32_t scriptNum = start; scriptNum < stop; scriptNum++) {
+        script::PubkeyHash script(scriptNum, chain.getAccess());
+        total += script.addressString().size();
+    }
+    return total;
+}
+
+size_t pubkeyHashStringsLength2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    std::vector<Address> addresses;
+    addresses.reserve(stop - start);
+    for (uint32_t scriptNum = start; scriptNum < stop; scriptNum++) {
+        addresses.emplace_back(scriptNum, AddressType::PUBKEYHASH, chain.getAccess());
+    }
+    auto strings = encodeAddresses(addresses);
+    size_t total = 0;
+    for (auto &string : strings) {
+        total += string.length;
+    }
+    return total;
+}
+
+// Visits the transactions in [start, stop) in a scattered order, like following spends does
+template <typename Func>
+static void visitScatteredTxes(uint32_t start, uint32_t stop, Func func) {
+    uint64_t count = stop - start;
+    for (uint64_t i = 0; i < count; i++) {
+        func(static_cast<uint32_t>(start + (i * 2654435761u) % count));
+    }
+}
+
+int64_t txHeightSum1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto &access = *chain.getAccess().chain;
+    auto firstBlock = access.getBlock(0);
+    auto lastBlock = access.getBlock(access.blockCount() - 1) + 1;
+    int64_t total = 0;
+    visitScatteredTxes(start, stop, [&](uint32_t txNum) {
+        auto it = std::upper_bound(firstBlock, lastBlock, txNum, [](uint32_t index, const RawBlock &b) {
+            return index < b.firstTxIndex;
+        });
+        total += std::distance(firstBlock, it) - 1;
+    });
+    return total;
+}
+
+int64_t txHeightSum2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto &access = *chain.getAccess().chain;
+    int64_t total = 0;
+    visitScatteredTxes(start, stop, [&](uint32_t txNum) {
+        total += access.getBlockHeight(txNum);
+    });
+    return total;
+}
+
+uint64_t outputCountSum1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto extract = [](const Transaction &tx) -> uint64_t { return tx.outputCount(); };
+    auto combine = [](uint64_t &a, uint64_t &b) -> uint64_t & { a += b; return a; };
+    
+    return chain.mapReduce<uint64_t>(start, stop, extract, combine);
+}
+
+uint64_t outputCountSum2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    auto &access = *chain.getAccess().chain;
+    auto firstTx = chain[start].firstTxIndex();
+    auto endTx = chain[stop - 1].endTxIndex();
+    return parallelReduce(chain.threadPool(), firstTx, endTx, uint64_t{0}, [&](uint64_t &total, uint64_t txNum) {
+        total += access.getTx(static_cast<uint32_t>(txNum))->outputCount;
+    }, [](uint64_t &total, uint64_t &chunkTotal) {
+        total += chunkTotal;
+    });
+}
+
+uint64_t blockAggregates1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        auto block = chain[height];
+        auto unspentValues = outputsUnspent(block) | ranges::view::transform([](const Output &output) { return output.getValue(); });
+        total += ranges::accumulate(unspentValues, uint64_t{0});
+        total += static_cast<uint64_t>(ranges::distance(inputsOfType(block, AddressType::Enum::PUBKEYHASH)));
+        total += ranges::accumulate(fees(block), uint64_t{0});
+    }
+    return total;
+}
+
+uint64_t blockAggregates2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        auto block = chain[height];
+        total += unspentOutputValue(block);
+        total += inputCountOfType(block, AddressType::Enum::PUBKEYHASH);
+        total += totalFee(block);
+    }
+    return total;
+}
+
+int64_t netTypeValue1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    int64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        auto block = chain[height];
+        RANGES_FOR(auto output, outputsOfType(block, AddressType::Enum::PUBKEYHASH)) {
+            total += output.getValue();
+        }
+        RANGES_FOR(auto input, inputsOfType(block, AddressType::Enum::PUBKEYHASH)) {
+            total -= input.getValue();
+        }
+    }
+    return total;
+}
+
+int64_t netTypeValue2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    int64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        total += chain[height].stats().netValue(AddressType::Enum::PUBKEYHASH);
+    }
+    return total;
+}
+
+uint64_t feeSum1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        RANGES_FOR(auto tx, chain[height]) {
+            total += fee(tx.rawTx());
+        }
+    }
+    return total;
+}
+
+uint64_t feeSum2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    for (uint32_t height = start; height < stop; height++) {
+        RANGES_FOR(auto tx, chain[height]) {
+            total += fee(tx);
+        }
+    }
+    return total;
+}
+
+// Balances at the end of the range of the addresses receiving outputs in its first block
+uint64_t addressBalanceSum1(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    RANGES_FOR(auto tx, chain[start]) {
+        RANGES_FOR(auto output, tx.outputs()) {
+            total += calculateBalance(output.getAddress().getOutputPointers(), static_cast<BlockHeight>(stop - 1), chain.getAccess());
+        }
+    }
+    return total;
+}
+
+uint64_t addressBalanceSum2(Blockchain &chain, uint32_t start, uint32_t stop) {
+    uint64_t total = 0;
+    RANGES_FOR(auto tx, chain[start]) {
+        RANGES_FOR(auto output, tx.outputs()) {
+            total += output.getAddress().calculateBalance(static_cast<BlockHeight>(stop - 1));
+        }
+    }
+    return total;
+}
+
+// Value held in the UTXO set once block stop - 1 was added. start is unused since the set depends on the whole chain
+uint64_t utxoSetValue1(Blockchain &chain, uint32_t, uint32_t stop) {
+    uint64_t total = 0;
+    for (uint32_t blockHeight = 0; blockHeight < stop; blockHeight++) {
+        RANGES_FOR(auto output, outputsSpentAfterHeight(chain[blockHeight], static_cast<BlockHeight>(stop))) {
+            total += output.getValue();
+        }
+        RANGES_FOR(auto output, outputsUnspent(chain[blockHeight])) {
+            total += output.getValue();
+        }
+    }
+    return total;
+}
+
+uint64_t utxoSetValue2(Blockchain &chain, uint32_t, uint32_t stop) {
+    auto utxos = getUTXOSet(static_cast<BlockHeight>(stop - 1), chain.getAccess());
+    uint64_t total = 0;
+    for (auto value : utxos.values) {
+        total += value;
+    }
+    return total;
+}
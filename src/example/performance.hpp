@@ -25,4 +25,31 @@ std::unordered_map<uint64_t, uint64_t> getOutputDistribution2(blocksci::Blockcha
 uint64_t maxValOutput1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
 uint64_t maxValOutput2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
 
+std::vector<blocksci::uint256> txSizedHashes1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+std::vector<blocksci::uint256> txSizedHashes2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+size_t pubkeyHashStringsLength1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+size_t pubkeyHashStringsLength2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+int64_t txHeightSum1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+int64_t txHeightSum2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+uint64_t outputCountSum1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+uint64_t outputCountSum2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+uint64_t blockAggregates1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+uint64_t blockAggregates2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+int64_t netTypeValue1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+int64_t netTypeValue2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+uint64_t feeSum1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+uint64_t feeSum2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+uint64_t addressBalanceSum1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+uint64_t addressBalanceSum2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
+uint64_t utxoSetValue1(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+uint64_t utxoSetValue2(blocksci::Blockchain &chain, uint32_t start, uint32_t stop);
+
 #endif /* performance_hpp */
@@ -0,0 +1,179 @@
+//
+//  address_prefix_index_creator.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "address_prefix_index_creator.hpp"
+#include "file_writer.hpp"
+
+#include <blocksci/address/address_encoder.hpp>
+#include <blocksci/address/address_info.hpp>
+#include <blocksci/index/address_prefix_index.hpp>
+#include <blocksci/scripts/script_access.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/file_mapper.hpp>
+#include <blocksci/util/parallel.hpp>
+#include <blocksci/util/state.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <queue>
+
+using blocksci::AddressPrefixEntry;
+using blocksci::AddressPrefixIndex;
+
+namespace {
+    // Scripts encoded and sorted in memory before being spilled to a run file
+    constexpr uint64_t runScriptCount = 1 << 24;
+    constexpr uint64_t encodeBatchSize = 4096;
+
+    boost::filesystem::path datPath(boost::filesystem::path path) {
+        return path.concat(".dat");
+    }
+}
+
+AddressPrefixIndexCreator::AddressPrefixIndexCreator(const ParserConfigurationBase &config_) : config(config_) {}
+
+bool AddressPrefixIndexCreator::exists() const {
+    return boost::filesystem::exists(config.addressPrefixIndexDirectory());
+}
+
+void AddressPrefixIndexCreator::updateTable(size_t table, uint32_t keptCount, uint32_t scriptCount, const blocksci::DataAccess &access) {
+    using namespace blocksci;
+
+    auto type = AddressPrefixIndex::indexedTypes[table];
+    auto lead = AddressPrefixIndex::sharedLead(config, table);
+    auto tablePath = AddressPrefixIndex::tablePath(config, table);
+    AddressEncoder encoder(config);
+    auto &pool = getThreadPool(config.threadCount);
+
+    std::vector<boost::filesystem::path> runPaths;
+    for (uint64_t runStart = uint64_t{keptCount} + 1; runStart <= scriptCount; runStart += runScriptCount) {
+        auto runEnd = std::min(runStart + runScriptCount, uint64_t{scriptCount} + 1);
+        auto accumulate = [&](std::vector<AddressPrefixEntry> &entries, uint64_t chunkBegin, uint64_t chunkEnd) {
+            std::vector<Address> batch;
+            std::vector<AddressString> strings(encodeBatchSize);
+            batch.reserve(encodeBatchSize);
+            for (auto batchStart = chunkBegin; batchStart < chunkEnd; batchStart += encodeBatchSize) {
+                batch.clear();
+                auto batchEnd = std::min(chunkEnd, batchStart + encodeBatchSize);
+                for (auto scriptNum = batchStart; scriptNum < batchEnd; scriptNum++) {
+                    if (AddressPrefixIndex::hasString(table, static_cast<uint32_t>(scriptNum), *access.scripts)) {
+                        batch.emplace_back(static_cast<uint32_t>(scriptNum), type, access);
+                    }
+                }
+                encoder.encode(batch.data(), batch.size(), strings.data());
+                for (size_t i = 0; i < batch.size(); i++) {
+                    entries.push_back(AddressPrefixIndex::makeEntry(lead, strings[i].chars, strings[i].length, batch[i].scriptNum));
+                }
+            }
+        };
+        auto combine = [](std::vector<AddressPrefixEntry> &entries, std::vector<AddressPrefixEntry> &chunkEntries) {
+            entries.insert(entries.end(), chunkEntries.begin(), chunkEntries.end());
+        };
+        auto entries = parallelReduceChunks(pool, runStart, runEnd, std::vector<AddressPrefixEntry>{}, accumulate, combine);
+        std::sort(entries.begin(), entries.end());
+
+        auto runPath = boost::filesystem::path{tablePath}.concat("_run" + std::to_string(runPaths.size()));
+        boost::filesystem::remove(datPath(runPath));
+        FixedSizeFileWriter<AddressPrefixEntry> runFile(runPath);
+        for (auto &entry : entries) {
+            runFile.write(entry);
+        }
+        runPaths.push_back(runPath);
+    }
+
+    auto newPath = boost::filesystem::path{tablePath}.concat("_new");
+    boost::filesystem::remove(datPath(newPath));
+    {
+        // The existing table comes first and may hold entries past keptCount left over from a rollback
+        std::vector<std::unique_ptr<FixedSizeFileMapper<AddressPrefixEntry>>> sources;
+        sources.push_back(std::make_unique<FixedSizeFileMapper<AddressPrefixEntry>>(tablePath));
+        for (auto &runPath : runPaths) {
+            sources.push_back(std::make_unique<FixedSizeFileMapper<AddressPrefixEntry>>(runPath));
+        }
+        std::vector<size_t> positions(sources.size(), 0);
+
+        using HeapItem = std::pair<AddressPrefixEntry, size_t>;
+        auto heapCompare = [](const HeapItem &a, const HeapItem &b) {
+            return b.first < a.first;
+        };
+        std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(heapCompare)> heap(heapCompare);
+        auto pushNext = [&](size_t source) {
+            auto &file = *sources[source];
+            auto &pos = positions[source];
+            while (pos < file.size()) {
+                auto entry = *file.getData(pos++);
+                if (source != 0 || entry.scriptNum <= keptCount) {
+                    heap.emplace(entry, source);
+                    return;
+                }
+            }
+        };
+        for (size_t source = 0; source < sources.size(); source++) {
+            pushNext(source);
+        }
+
+        FixedSizeFileWriter<AddressPrefixEntry> newFile(newPath);
+        while (!heap.empty()) {
+            auto item = heap.top();
+            heap.pop();
+            newFile.write(item.first);
+            pushNext(item.second);
+        }
+    }
+
+    // Readers that still have the old table mapped keep using it until they reload
+    boost::filesystem::rename(datPath(newPath), datPath(tablePath));
+    for (auto &runPath : runPaths) {
+        boost::filesystem::remove(datPath(runPath));
+    }
+}
+
+void AddressPrefixIndexCreator::update() {
+    using namespace blocksci;
+
+    boost::filesystem::create_directories(config.addressPrefixIndexDirectory());
+    DataAccess access(config);
+
+    FixedSizeFileMapper<uint32_t, AccessMode::readwrite> progressFile(AddressPrefixIndex::progressPath(config));
+    while (progressFile.size() < AddressPrefixIndex::tableCount) {
+        progressFile.write(0);
+    }
+
+    std::cout << "Updating address prefix index\n";
+
+    for (size_t table = 0; table < AddressPrefixIndex::tableCount; table++) {
+        auto type = AddressPrefixIndex::indexedTypes[table];
+        auto scriptCount = access.scripts->scriptCount(dedupType(type));
+        auto keptCount = std::min(*progressFile.getData(table), scriptCount);
+        if (keptCount == scriptCount) {
+            continue;
+        }
+        std::cout << "Indexing " << scriptCount - keptCount << " " << addressName(type) << " addresses\n";
+        updateTable(table, keptCount, scriptCount, access);
+        // Only recorded once the table has been replaced so that an interrupted update is redone
+        *progressFile.getData(table) = scriptCount;
+    }
+}
+
+void AddressPrefixIndexCreator::rollback(const blocksci::State &state) {
+    using namespace blocksci;
+
+    if (!exists()) {
+        return;
+    }
+
+    // Entries for removed scripts stay in the tables but are ignored above the progress and dropped by the next update
+    FixedSizeFileMapper<uint32_t, AccessMode::readwrite> progressFile(AddressPrefixIndex::progressPath(config));
+    auto tableCount = std::min(progressFile.size(), AddressPrefixIndex::tableCount);
+    for (size_t table = 0; table < tableCount; table++) {
+        auto scriptCount = state.scriptCounts[static_cast<size_t>(dedupType(AddressPrefixIndex::indexedTypes[table]))];
+        auto &progress = *progressFile.getData(table);
+        progress = std::min(progress, scriptCount > 0 ? scriptCount - 1 : 0);
+    }
+}
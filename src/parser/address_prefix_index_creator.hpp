@@ -0,0 +1,35 @@
+//
+//  address_prefix_index_creator.hpp
+//  blocksci
+//
+
+#ifndef address_prefix_index_creator_hpp
+#define address_prefix_index_creator_hpp
+
+#include "parser_fwd.hpp"
+#include "parser_configuration.hpp"
+
+namespace blocksci {
+    class DataAccess;
+    struct State;
+}
+
+/* Builds the optional AddressPrefixIndex. Scripts added since the last update are encoded and sorted in runs
+ * that fit in memory, then merged with the existing table in one pass.
+ */
+class AddressPrefixIndexCreator {
+    ParserConfigurationBase config;
+    
+    void updateTable(size_t table, uint32_t keptCount, uint32_t scriptCount, const blocksci::DataAccess &access);
+    
+public:
+    explicit AddressPrefixIndexCreator(const ParserConfigurationBase &config);
+    
+    // The index is only maintained once it has been built with prefix-index-update
+    bool exists() const;
+    
+    void update();
+    void rollback(const blocksci::State &state);
+};
+
+#endif /* address_prefix_index_creator_hpp */
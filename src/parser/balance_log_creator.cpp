@@ -0,0 +1,241 @@
+//
+//  balance_log_creator.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "balance_log_creator.hpp"
+#include "file_writer.hpp"
+
+#include <blocksci/address/address_info.hpp>
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/chain/raw_block.hpp>
+#include <blocksci/chain/raw_transaction.hpp>
+#include <blocksci/index/balance_log.hpp>
+#include <blocksci/scripts/script_access.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/file_mapper.hpp>
+#include <blocksci/util/parallel.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <queue>
+#include <tuple>
+
+using blocksci::BalanceChange;
+using blocksci::BalanceLog;
+using blocksci::BlockHeight;
+
+namespace {
+    // Transactions whose changes are collected in memory before being spilled to run files
+    constexpr uint64_t windowTxCount = 1 << 22;
+    
+    struct BalanceRecord {
+        uint32_t scriptNum;
+        BlockHeight height;
+        int64_t change;
+        
+        bool operator<(const BalanceRecord &other) const {
+            return std::tie(scriptNum, height) < std::tie(other.scriptNum, other.height);
+        }
+    };
+    
+    using TypeRecords = std::array<std::vector<BalanceRecord>, blocksci::AddressType::size>;
+    
+    boost::filesystem::path datPath(boost::filesystem::path path) {
+        return path.concat(".dat");
+    }
+    
+    void addRecord(TypeRecords &records, const blocksci::Inout &inout, BlockHeight height, bool spent) {
+        auto value = static_cast<int64_t>(inout.getValue());
+        if (inout.toAddressNum == 0 || value == 0) {
+            return;
+        }
+        records[static_cast<size_t>(inout.getType())].push_back(BalanceRecord{inout.toAddressNum, height, spent ? -value : value});
+    }
+}
+
+BalanceLogCreator::BalanceLogCreator(const ParserConfigurationBase &config_) : config(config_) {}
+
+bool BalanceLogCreator::exists() const {
+    return boost::filesystem::exists(config.balanceLogDirectory());
+}
+
+void BalanceLogCreator::updateType(blocksci::AddressType::Enum type, BlockHeight keptCount, const std::vector<boost::filesystem::path> &runPaths, const blocksci::DataAccess &access) {
+    using namespace blocksci;
+    
+    auto offsetsPath = BalanceLog::offsetsPath(config, type);
+    auto dataPath = BalanceLog::dataPath(config, type);
+    auto newOffsetsPath = boost::filesystem::path{offsetsPath}.concat("_new");
+    auto newDataPath = boost::filesystem::path{dataPath}.concat("_new");
+    boost::filesystem::remove(datPath(newOffsetsPath));
+    boost::filesystem::remove(datPath(newDataPath));
+    {
+        FixedSizeFileMapper<uint64_t> oldOffsets(offsetsPath);
+        FixedSizeFileMapper<BalanceChange> oldData(dataPath);
+        auto oldScriptCount = oldOffsets.size() > 0 ? oldOffsets.size() - 1 : 0;
+        
+        std::vector<std::unique_ptr<FixedSizeFileMapper<BalanceRecord>>> runs;
+        for (auto &runPath : runPaths) {
+            runs.push_back(std::make_unique<FixedSizeFileMapper<BalanceRecord>>(runPath));
+        }
+        std::vector<size_t> positions(runs.size(), 0);
+        
+        using HeapItem = std::pair<BalanceRecord, size_t>;
+        auto heapCompare = [](const HeapItem &a, const HeapItem &b) {
+            return b.first < a.first;
+        };
+        std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(heapCompare)> heap(heapCompare);
+        auto pushNext = [&](size_t run) {
+            auto &pos = positions[run];
+            if (pos < runs[run]->size()) {
+                heap.emplace(*runs[run]->getData(pos++), run);
+            }
+        };
+        for (size_t run = 0; run < runs.size(); run++) {
+            pushNext(run);
+        }
+        
+        FixedSizeFileWriter<uint64_t> offsetsFile(newOffsetsPath);
+        FixedSizeFileWriter<BalanceChange> dataFile(newDataPath);
+        uint64_t offset = 0;
+        offsetsFile.write(offset);
+        auto scriptCount = access.scripts->scriptCount(dedupType(type));
+        for (uint32_t scriptNum = 1; scriptNum <= scriptCount; scriptNum++) {
+            uint64_t balance = 0;
+            if (scriptNum <= oldScriptCount) {
+                auto first = *oldOffsets.getData(scriptNum - 1);
+                auto last = *oldOffsets.getData(scriptNum);
+                for (auto i = first; i < last; i++) {
+                    auto change = *oldData.getData(i);
+                    // Changes at or past keptCount are from blocks removed by a rollback
+                    if (change.height >= keptCount) {
+                        break;
+                    }
+                    dataFile.write(change);
+                    balance = change.balance;
+                    offset++;
+                }
+            }
+            while (!heap.empty() && heap.top().first.scriptNum == scriptNum) {
+                auto height = heap.top().first.height;
+                int64_t change = 0;
+                while (!heap.empty() && heap.top().first.scriptNum == scriptNum && heap.top().first.height == height) {
+                    auto item = heap.top();
+                    heap.pop();
+                    change += item.first.change;
+                    pushNext(item.second);
+                }
+                if (change != 0) {
+                    balance += static_cast<uint64_t>(change);
+                    dataFile.write(BalanceChange{height, balance});
+                    offset++;
+                }
+            }
+            offsetsFile.write(offset);
+        }
+    }
+    
+    // Readers that still have the old files mapped keep using them until they reload
+    boost::filesystem::rename(datPath(newDataPath), datPath(dataPath));
+    boost::filesystem::rename(datPath(newOffsetsPath), datPath(offsetsPath));
+}
+
+void BalanceLogCreator::update() {
+    using namespace blocksci;
+    
+    boost::filesystem::create_directories(config.balanceLogDirectory());
+    DataAccess access(config);
+    
+    FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> progressFile(BalanceLog::progressPath(config));
+    if (progressFile.size() == 0) {
+        progressFile.write(0);
+    }
+    
+    auto blockCount = access.chain->blockCount();
+    auto keptCount = std::min(*progressFile.getData(0), blockCount);
+    if (keptCount == blockCount) {
+        return;
+    }
+    
+    std::cout << "Updating balance log with " << blockCount - keptCount << " blocks\n";
+    
+    auto &pool = getThreadPool(config.threadCount);
+    std::array<std::vector<boost::filesystem::path>, AddressType::size> runPaths;
+    auto windowStart = keptCount;
+    while (windowStart < blockCount) {
+        auto windowEnd = windowStart;
+        uint64_t txCount = 0;
+        while (windowEnd < blockCount && txCount < windowTxCount) {
+            txCount += access.chain->getBlock(windowEnd)->numTxes;
+            windowEnd++;
+        }
+        
+        auto accumulate = [&](TypeRecords &records, uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (auto i = chunkBegin; i < chunkEnd; i++) {
+                auto height = static_cast<BlockHeight>(i);
+                auto block = access.chain->getBlock(height);
+                for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->numTxes; txNum++) {
+                    auto tx = access.chain->getTx(txNum);
+                    for (uint16_t j = 0; j < tx->inputCount; j++) {
+                        addRecord(records, tx->getInput(j), height, true);
+                    }
+                    for (uint16_t j = 0; j < tx->outputCount; j++) {
+                        addRecord(records, tx->getOutput(j), height, false);
+                    }
+                }
+            }
+        };
+        auto combine = [](TypeRecords &records, TypeRecords &chunkRecords) {
+            for (size_t i = 0; i < AddressType::size; i++) {
+                records[i].insert(records[i].end(), chunkRecords[i].begin(), chunkRecords[i].end());
+            }
+        };
+        auto records = parallelReduceChunks(pool, static_cast<uint64_t>(windowStart), static_cast<uint64_t>(windowEnd), TypeRecords{}, accumulate, combine);
+        
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto &typeRecords = records[i];
+            if (typeRecords.empty()) {
+                continue;
+            }
+            std::sort(typeRecords.begin(), typeRecords.end());
+            auto runPath = BalanceLog::dataPath(config, static_cast<AddressType::Enum>(i)).concat("_run" + std::to_string(runPaths[i].size()));
+            boost::filesystem::remove(datPath(runPath));
+            FixedSizeFileWriter<BalanceRecord> runFile(runPath);
+            for (auto &record : typeRecords) {
+                runFile.write(record);
+            }
+            runPaths[i].push_back(runPath);
+        }
+        windowStart = windowEnd;
+    }
+    
+    for (size_t i = 0; i < AddressType::size; i++) {
+        updateType(static_cast<AddressType::Enum>(i), keptCount, runPaths[i], access);
+        for (auto &runPath : runPaths[i]) {
+            boost::filesystem::remove(datPath(runPath));
+        }
+    }
+    
+    // Only recorded once every type has been merged so that an interrupted update is redone
+    *progressFile.getData(0) = blockCount;
+}
+
+void BalanceLogCreator::rollback(BlockHeight blockKeepCount) {
+    using namespace blocksci;
+    
+    if (!exists()) {
+        return;
+    }
+    
+    // Changes from removed blocks are ignored by readers and dropped by the next update
+    FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> progressFile(BalanceLog::progressPath(config));
+    if (progressFile.size() > 0) {
+        auto &progress = *progressFile.getData(0);
+        progress = std::min(progress, blockKeepCount);
+    }
+}
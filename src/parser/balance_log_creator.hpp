@@ -0,0 +1,40 @@
+//
+//  balance_log_creator.hpp
+//  blocksci
+//
+
+#ifndef balance_log_creator_hpp
+#define balance_log_creator_hpp
+
+#include "parser_configuration.hpp"
+
+#include <blocksci/address/address_types.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+}
+
+/* Builds the optional BalanceLog. The changes made by blocks added since the last update are collected in
+ * windows, sorted by script and height and spilled to run files, then merged with the existing log of each
+ * address type in one sequential pass.
+ */
+class BalanceLogCreator {
+    ParserConfigurationBase config;
+    
+    void updateType(blocksci::AddressType::Enum type, blocksci::BlockHeight keptCount, const std::vector<boost::filesystem::path> &runPaths, const blocksci::DataAccess &access);
+    
+public:
+    explicit BalanceLogCreator(const ParserConfigurationBase &config);
+    
+    // The log is only maintained once it has been built with balance-log-update
+    bool exists() const;
+    
+    void update();
+    void rollback(blocksci::BlockHeight blockKeepCount);
+};
+
+#endif /* balance_log_creator_hpp */
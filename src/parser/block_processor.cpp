@@ -22,6 +22,7 @@
 #include "output_spend_data.hpp"
 #include "serializable_map.hpp"
 #include "progress_bar.hpp"
+#include "rpc_block_fetcher.hpp"
 
 #include <blocksci/util/hash.hpp>
 #include <blocksci/util/bitcoin_uint256.hpp>
@@ -40,6 +41,8 @@
 
 #include <cmath>
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <thread>
 #include <fstream>
 #include <iostream>
@@ -184,15 +187,84 @@ public:
 
 template <>
 class BlockFileReader<RPCTag> : public BlockFileReaderBase {
-    BitcoinAPI bapi;
+    using BlockTransactions = std::vector<getrawtransaction_t>;
+    using RawBlockData = std::vector<char>;
+    
+    std::unique_ptr<RPCBlockFetcher<BlockTransactions>> fetcher;
+    BlockTransactions currentTxes;
+    
+    // Raw block mode keeps each block buffer alive until every transaction pointing into it has finished processing
+    std::unique_ptr<RPCBlockFetcher<RawBlockData>> rawFetcher;
+    std::deque<std::pair<RawBlockData, uint32_t>> rawBlocks;
+    std::unique_ptr<SafeMemReader> reader;
     
     uint32_t firstTxNum;
     uint32_t currentTxOffset;
     blocksci::BlockHeight currentHeight;
-    BlockInfo<RPCTag> block;
+    
+    static BlockTransactions fetchBlock(BitcoinAPI &bapi, const BlockInfo<RPCTag> &block) {
+        BlockTransactions txes;
+        if (block.height == 0) {
+            return txes;
+        }
+        auto txids = block.tx;
+        if (txids.empty()) {
+            // Transaction ids aren't kept in the chain index so blocks indexed by an earlier run must be refetched
+            txids = bapi.getblock(block.hash.GetHex()).tx;
+        }
+        txes.reserve(txids.size());
+        for (auto &txid : txids) {
+            txes.push_back(bapi.getrawtransaction(txid, 1));
+        }
+        return txes;
+    }
+    
+    static RawBlockData fetchRawBlock(BitcoinAPI &bapi, const BlockInfo<RPCTag> &block) {
+        RawBlockData data;
+        if (block.height == 0) {
+            return data;
+        }
+        Json::Value params;
+        params.append(block.hash.GetHex());
+        params.append(false);
+        auto hex = bapi.sendcommand("getblock", params).asString();
+        if (hex.size() % 2 != 0) {
+            std::stringstream ss;
+            ss << "Error: getblock returned hex of odd length for block " << block.hash.GetHex();
+            throw std::runtime_error(ss.str());
+        }
+        data.resize(hex.size() / 2);
+        for (size_t i = 0; i < data.size(); i++) {
+            auto high = blocksci::HexDigit(hex[2 * i]);
+            auto low = blocksci::HexDigit(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                std::stringstream ss;
+                ss << "Error: getblock returned invalid hex for block " << block.hash.GetHex();
+                throw std::runtime_error(ss.str());
+            }
+            data[i] = static_cast<char>((high << 4) | low);
+        }
+        return data;
+    }
+    
+    template<bool shouldAdvance>
+    void nextRawTxImp(RawTransaction *tx, bool isSegwit) {
+        auto firstTxOffset = reader->offset();
+        tx->load(*reader, firstTxNum + currentTxOffset, currentHeight, isSegwit);
+        if (shouldAdvance) {
+            currentTxOffset++;
+        } else {
+            reader->reset(firstTxOffset);
+        }
+    }
     
     template<bool shouldAdvance>
     void nextTxImp(RawTransaction *tx, bool isSegwit) {
+        // Both modes write the same placeholder genesis transaction since its real one can't be fetched as JSON
+        if (rawFetcher && currentHeight != 0) {
+            nextRawTxImp<shouldAdvance>(tx, isSegwit);
+            return;
+        }
         if (currentHeight == 0) {
             tx->outputs.clear();
             tx->outputs.reserve(1);
@@ -206,8 +278,7 @@ class BlockFileReader<RPCTag> : public BlockFileReaderBase {
             tx->txNum = 0;
             tx->isSegwit = false;
         } else {
-            auto txinfo = bapi.getrawtransaction(block.tx[currentTxOffset], 1);
-            tx->load(txinfo, firstTxNum + currentTxOffset, currentHeight, isSegwit);
+            tx->load(currentTxes[currentTxOffset], firstTxNum + currentTxOffset, currentHeight, isSegwit);
         }
         if (shouldAdvance) {
             currentTxOffset++;
@@ -215,10 +286,26 @@ class BlockFileReader<RPCTag> : public BlockFileReaderBase {
     }
     
 public:
-    BlockFileReader(const ParserConfiguration<RPCTag> &config, std::vector<BlockInfo<RPCTag>> &, uint32_t) : bapi(config.createBitcoinAPI()) {}
+    BlockFileReader(const ParserConfiguration<RPCTag> &config, std::vector<BlockInfo<RPCTag>> &blocksToAdd, uint32_t) {
+        if (config.rawBlocks) {
+            rawFetcher = std::make_unique<RPCBlockFetcher<RawBlockData>>(config, blocksToAdd, fetchRawBlock);
+        } else {
+            fetcher = std::make_unique<RPCBlockFetcher<BlockTransactions>>(config, blocksToAdd, fetchBlock);
+        }
+    }
     
-    void nextBlock(BlockInfo<RPCTag> &block_, uint32_t txNum) {
-        block = block_;
+    void nextBlock(BlockInfo<RPCTag> &block, uint32_t txNum) {
+        if (rawFetcher) {
+            rawBlocks.emplace_back(rawFetcher->nextBlock(), txNum + block.nTx);
+            if (block.height != 0) {
+                auto &data = rawBlocks.back().first;
+                reader = std::make_unique<SafeMemReader>(data.data(), data.size());
+                reader->advance(sizeof(CBlockHeader));
+                reader->readVariableLengthInteger();
+            }
+        } else {
+            currentTxes = fetcher->nextBlock();
+        }
         currentHeight = block.height;
         firstTxNum = txNum;
         currentTxOffset = 0;
@@ -232,7 +319,11 @@ public:
         nextTxImp<false>(tx, isSegwit);
     }
     
-    void receivedFinishedTx(RawTransaction *) override {}
+    void receivedFinishedTx(RawTransaction *tx) override {
+        while (!rawBlocks.empty() && rawBlocks.front().second < tx->txNum) {
+            rawBlocks.pop_front();
+        }
+    }
 };
 
 #endif
@@ -245,6 +336,8 @@ std::vector<unsigned char> readNewBlock(uint32_t firstTxNum, const BlockInfoBase
     uint32_t headerSize = 80 + variableLengthIntSize(block.nTx);
     uint32_t baseSize = headerSize;
     uint32_t realSize = headerSize;
+    std::vector<RawTransaction *> blockTxes;
+    blockTxes.reserve(block.nTx);
     for (uint32_t j = 0; j < block.nTx; j++) {
         RawTransaction *tx = nullptr;
         if (!loadFunc(tx)) {
@@ -261,9 +354,12 @@ std::vector<unsigned char> readNewBlock(uint32_t firstTxNum, const BlockInfoBase
         
         fileReader.nextTx(tx, isSegwit);
         
-        files.sequenceFile.writeIndexGroup();
-        for (auto &input : tx->inputs) {
-            files.sequenceFile.write(input.sequenceNum);
+        files.txHeightFile.write(block.height);
+        
+        // Filled in by backUpdateTxes once the outputs are spent
+        files.spendingInputFile.writeIndexGroup();
+        for (size_t i = 0; i < tx->outputs.size(); i++) {
+            files.spendingInputFile.write(blocksci::unknownSpendingInput);
         }
         
         if (tx->inputs.size() == 1 && tx->inputs[0].rawOutputPointer.hash == nullHash) {
@@ -272,9 +368,22 @@ std::vector<unsigned char> readNewBlock(uint32_t firstTxNum, const BlockInfoBase
             tx->inputs.clear();
         }
         
+        for (uint32_t i = 0; i < tx->inputs.size(); i++) {
+            auto sequenceNum = tx->inputs[i].sequenceNum;
+            if (sequenceNum != blocksci::defaultSequenceNum) {
+                files.sparseSequenceFile.write(blocksci::SparseSequenceNum{firstTxNum + j, i, sequenceNum});
+            }
+        }
+        
         baseSize += tx->baseSize;
         realSize += tx->realSize;
         
+        blockTxes.push_back(tx);
+    }
+    
+    // Hashing the whole block at once lets the transactions share SIMD lanes instead of being hashed one by one
+    calculateTxHashes(blockTxes);
+    for (auto tx : blockTxes) {
         outFunc(tx);
     }
     blocksci::RawBlock blocksciBlock{firstTxNum, block.nTx, static_cast<uint32_t>(static_cast<int>(block.height)), block.hash, block.header.nVersion, block.header.nTime, block.header.nBits, block.header.nNonce, realSize, baseSize, files.blockCoinbaseFile.size()};
@@ -366,7 +475,7 @@ void serializeTransaction(RawTransaction *tx, IndexedFileWriter<1> &txFile, Fixe
     for (size_t i = 0; i < tx->inputs.size(); i++) {
         auto &input = tx->inputs[i];
         auto &scriptInput = tx->scriptInputs[i];
-        linkDataFile.write({input.getOutputPointer(), tx->txNum});
+        linkDataFile.write({input.getOutputPointer(), tx->txNum, static_cast<uint16_t>(i)});
         blocksci::Inout blocksciInput{input.utxo.txNum, scriptInput.address(), input.utxo.value};
         txFile.write(blocksciInput);
     }
@@ -395,6 +504,8 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
     {
         blocksci::IndexedFileMapper<blocksci::AccessMode::readwrite, blocksci::RawTransaction> txFile(config.txFilePath());
         
+        blocksci::IndexedFileMapper<blocksci::AccessMode::readwrite, uint16_t> spendingInputFile(config.spendingInputFilePath());
+        
         blocksci::FixedSizeFileMapper<OutputLinkData> linkDataFile_(config.txUpdatesFilePath());
         const auto &linkDataFile = linkDataFile_;
         
@@ -418,6 +529,7 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
             auto tx = txFile.getData(update.pointer.txNum);
             auto &output = tx->getOutput(update.pointer.inoutNum);
             output.linkedTxNum = update.txNum;
+            spendingInputFile.getDataAtIndex(update.pointer.txNum)[update.pointer.inoutNum] = update.inputNum;
             count++;
             progressBar.update(count);
         }
@@ -508,7 +620,7 @@ ProcessStep<ProcessFunc, AdvanceFunc> makeProcessStep(std::atomic<bool> &prevDon
     return ProcessStep<ProcessFunc, AdvanceFunc>(prevDone, func, advanceFunc);
 }
 
-NewBlocksFiles::NewBlocksFiles(const ParserConfigurationBase &config) : blockCoinbaseFile(config.blockCoinbaseFilePath()), blockFile(config.blockFilePath()), sequenceFile(config.sequenceFilePath()) {}
+NewBlocksFiles::NewBlocksFiles(const ParserConfigurationBase &config) : blockCoinbaseFile(config.blockCoinbaseFilePath()), blockFile(config.blockFilePath()), sparseSequenceFile(config.sparseSequenceFilePath()), txHeightFile(config.txHeightsFilePath()), spendingInputFile(config.spendingInputFilePath()) {}
 
 template <typename ParseTag>
 void BlockProcessor::addNewBlocks(const ParserConfiguration<ParseTag> &config, std::vector<BlockInfo<ParseTag>> blocks, UTXOState &utxoState, UTXOAddressState &utxoAddressState, AddressState &addressState, UTXOScriptState &utxoScriptState) {
@@ -671,9 +783,14 @@ void BlockProcessor::addNewBlocks(const ParserConfiguration<ParseTag> &config, s
 template <typename ParseTag>
 void BlockProcessor::addNewBlocksSingle(const ParserConfiguration<ParseTag> &config, std::vector<BlockInfo<ParseTag>> blocks, UTXOState &utxoState, UTXOAddressState &utxoAddressState, AddressState &addressState, UTXOScriptState &utxoScriptState) {
     
-    RawTransaction realTx;
+    // readNewBlock decodes a whole block before processing it, so each transaction of a block needs its own buffer
+    std::vector<std::unique_ptr<RawTransaction>> blockTxes;
+    size_t nextBlockTx = 0;
     auto loadFinishedTx = [&](RawTransaction *&tx) {
-        tx = &realTx;
+        if (nextBlockTx == blockTxes.size()) {
+            blockTxes.push_back(std::make_unique<RawTransaction>());
+        }
+        tx = blockTxes[nextBlockTx++].get();
         return true;
     };
         
@@ -706,6 +823,7 @@ void BlockProcessor::addNewBlocksSingle(const ParserConfiguration<ParseTag> &con
     for (auto &block : blocks) {
         fileReader.nextBlock(block, currentTxNum);
         readNewBlock(currentTxNum, block, fileReader, files, loadFinishedTx, outFunc);
+        nextBlockTx = 0;
         currentTxNum += block.nTx;
     }
 }
@@ -36,7 +36,9 @@ public:
 struct NewBlocksFiles {
     ArbitraryFileWriter blockCoinbaseFile;
     FixedSizeFileWriter<blocksci::RawBlock> blockFile;
-    IndexedFileWriter<1> sequenceFile;
+    FixedSizeFileWriter<blocksci::SparseSequenceNum> sparseSequenceFile;
+    FixedSizeFileWriter<blocksci::BlockHeight> txHeightFile;
+    IndexedFileWriter<1> spendingInputFile;
     
     NewBlocksFiles(const ParserConfigurationBase &config);
 };
@@ -44,6 +46,7 @@ struct NewBlocksFiles {
 struct OutputLinkData {
     blocksci::OutputPointer pointer;
     uint32_t txNum;
+    uint16_t inputNum;
 };
 
 std::vector<unsigned char> readNewBlock(uint32_t firstTxNum, const BlockInfoBase &block, BlockFileReaderBase &fileReader, NewBlocksFiles &files, const std::function<bool(RawTransaction *&tx)> &loadFunc, const std::function<void(RawTransaction *tx)> &outFunc);
@@ -27,22 +27,14 @@
 #include <blocksci/chain/output.hpp>
 #include <blocksci/index/address_index.hpp>
 
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-
-#include <boost/filesystem/fstream.hpp>
-
 #ifdef BLOCKSCI_FILE_PARSER
 void replayBlock(const ParserConfiguration<FileTag> &config, blocksci::BlockHeight blockNum) {
     blocksci::ECCVerifyHandle handle;
-    ChainIndex<FileTag> index;
-    boost::filesystem::ifstream inFile(config.blockListPath(), std::ios::binary);
-    if (!inFile.good()) {
+    ChainIndex<FileTag> index(config);
+    if (index.size() == 0) {
         throw std::runtime_error("Can only replay block that has already been processed");
     }
     
-    boost::archive::binary_iarchive ia(inFile);
-    ia >> index;
     auto chain = index.generateChain(blockNum);
     auto block = chain.back();
     auto blockPath = config.pathForBlockFile(block.nFile);
@@ -21,10 +21,6 @@
 #include <bitcoinapi/bitcoinapi.h>
 #endif
 
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/serialization/unordered_map.hpp>
-#include <boost/serialization/vector.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include <cmath>
@@ -59,26 +55,192 @@ int maxBlockFileNum(int startFile, const ParserConfiguration<FileTag> &config) {
     return fileNum - 1;
 }
 
+namespace {
+    constexpr size_t minHashTableSize = 1 << 16;
+    
+    size_t hashSlot(const blocksci::uint256 &hash, size_t capacity) {
+        return static_cast<size_t>(hash.GetUint64(0)) & (capacity - 1);
+    }
+}
+
+template<typename ParseTag>
+ChainIndex<ParseTag>::ChainIndex(const ParserConfigurationBase &config) : blockFile(config.blockIndexFilePath()), hashTable(config.blockIndexHashesFilePath()) {
+    auto blockCount = blockFile.size();
+    if (blockCount > 0) {
+        // The hash table may be missing the last records if a previous update was interrupted
+        auto lastHash = blockFile.getData(blockCount - 1)->hash;
+        if (hashTable.size() < 2 * blockCount || !findBlock(lastHash)) {
+            auto capacity = minHashTableSize;
+            while (capacity < 2 * blockCount) {
+                capacity *= 2;
+            }
+            rebuildHashTable(capacity);
+        }
+    }
+}
+
+template<typename ParseTag>
+ranges::optional<uint32_t> ChainIndex<ParseTag>::findBlock(const blocksci::uint256 &hash) const {
+    auto capacity = hashTable.size();
+    if (capacity == 0) {
+        return ranges::nullopt;
+    }
+    auto slot = hashSlot(hash, capacity);
+    while (true) {
+        auto entry = *hashTable.getData(slot);
+        if (entry == 0) {
+            return ranges::nullopt;
+        }
+        auto blockNum = entry - 1;
+        if (blockNum < blockFile.size() && blockFile.getData(blockNum)->hash == hash) {
+            return blockNum;
+        }
+        slot = (slot + 1) & (capacity - 1);
+    }
+}
+
 template<typename ParseTag>
-template<class Archive>
-void ChainIndex<ParseTag>::serialize(Archive & ar, const unsigned int) {
-    ar & blockList;
-    ar & newestBlock;
+void ChainIndex<ParseTag>::insertHash(const blocksci::uint256 &hash, uint32_t blockNum) {
+    auto capacity = hashTable.size();
+    auto slot = hashSlot(hash, capacity);
+    while (*hashTable.getData(slot) != 0) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    *hashTable.getData(slot) = blockNum + 1;
+}
+
+template<typename ParseTag>
+void ChainIndex<ParseTag>::rebuildHashTable(size_t capacity) {
+    hashTable.truncate(0);
+    hashTable.truncate(capacity);
+    auto blockCount = static_cast<uint32_t>(blockFile.size());
+    for (uint32_t i = 0; i < blockCount; i++) {
+        insertHash(blockFile.getData(i)->hash, i);
+    }
+}
+
+template<typename ParseTag>
+bool ChainIndex<ParseTag>::addBlock(const BlockType &block) {
+    if (!std::is_same<RecordType, BlockType>::value) {
+        newBlocks[block.hash] = block;
+    }
+    
+    if (findBlock(block.hash)) {
+        return false;
+    }
+    
+    if (2 * (blockFile.size() + 1) > hashTable.size()) {
+        rebuildHashTable(std::max(minHashTableSize, hashTable.size() * 2));
+    }
+    
+    auto blockNum = static_cast<uint32_t>(blockFile.size());
+    blockFile.write(static_cast<const RecordType &>(block));
+    insertHash(block.hash, blockNum);
+    return true;
+}
+
+template<typename ParseTag>
+void ChainIndex<ParseTag>::resolveHeights() {
+    std::unordered_multimap<blocksci::uint256, uint32_t> unresolvedBlocks;
+    auto blockCount = static_cast<uint32_t>(blockFile.size());
+    for (uint32_t i = 0; i < blockCount; i++) {
+        auto block = blockFile.getData(i);
+        if (block->height < 0) {
+            unresolvedBlocks.emplace(block->header.hashPrevBlock, i);
+        }
+    }
+    
+    blocksci::uint256 nullHash;
+    nullHash.SetNull();
+    
+    std::vector<std::pair<blocksci::uint256, blocksci::BlockHeight>> queue;
+    
+    // Start from every parent that is either the null hash or a block whose height is already known
+    for (auto it = unresolvedBlocks.begin(); it != unresolvedBlocks.end(); it = unresolvedBlocks.equal_range(it->first).second) {
+        if (it->first == nullHash) {
+            queue.emplace_back(nullHash, 0);
+        } else if (auto parentNum = findBlock(it->first)) {
+            auto parent = blockFile.getData(*parentNum);
+            if (parent->height >= 0) {
+                queue.emplace_back(parent->hash, parent->height);
+            }
+        }
+    }
+    
+    while (!queue.empty()) {
+        blocksci::uint256 blockHash;
+        blocksci::BlockHeight height;
+        std::tie(blockHash, height) = queue.back();
+        queue.pop_back();
+        for (auto ret = unresolvedBlocks.equal_range(blockHash); ret.first != ret.second; ++ret.first) {
+            auto block = blockFile.getData(ret.first->second);
+            block->height = height + 1;
+            queue.emplace_back(block->hash, block->height);
+        }
+    }
 }
 
-template void ChainIndex<FileTag>::serialize(boost::archive::binary_iarchive& archive, const unsigned int version);
-template void ChainIndex<FileTag>::serialize(boost::archive::binary_oarchive& archive, const unsigned int version);
-template void ChainIndex<RPCTag>::serialize(boost::archive::binary_iarchive& archive, const unsigned int version);
-template void ChainIndex<RPCTag>::serialize(boost::archive::binary_oarchive& archive, const unsigned int version);
+template<typename ParseTag>
+std::vector<typename ChainIndex<ParseTag>::BlockType> ChainIndex<ParseTag>::generateChain(blocksci::BlockHeight maxBlockHeight) const {
+    std::vector<BlockType> chain;
+    ranges::optional<uint32_t> maxHeightBlockNum;
+    blocksci::BlockHeight maxHeight = std::numeric_limits<blocksci::BlockHeight>::min();
+    auto blockCount = static_cast<uint32_t>(blockFile.size());
+    for (uint32_t i = 0; i < blockCount; i++) {
+        auto height = blockFile.getData(i)->height;
+        if (height > maxHeight) {
+            maxHeightBlockNum = i;
+            maxHeight = height;
+        }
+    }
+    
+    if (!maxHeightBlockNum) {
+        return chain;
+    }
+    
+    blocksci::uint256 nullHash;
+    nullHash.SetNull();
+    
+    chain.reserve(static_cast<size_t>(static_cast<int>(maxHeight)) + 1);
+    auto blockNum = *maxHeightBlockNum;
+    while (true) {
+        auto block = blockFile.getData(blockNum);
+        auto it = newBlocks.find(block->hash);
+        if (it != newBlocks.end()) {
+            chain.push_back(it->second);
+        } else {
+            chain.push_back(BlockType{*block});
+        }
+        auto &prevHash = block->header.hashPrevBlock;
+        if (prevHash == nullHash) {
+            break;
+        }
+        auto prevBlockNum = findBlock(prevHash);
+        if (!prevBlockNum) {
+            throw std::runtime_error("Chain index is missing block " + prevHash.GetHex());
+        }
+        blockNum = *prevBlockNum;
+    }
+    
+    std::reverse(chain.begin(), chain.end());
+    if (maxBlockHeight < 0) {
+        return {chain.begin(), chain.end() + static_cast<int>(maxBlockHeight)};
+    } else if (maxBlockHeight == 0 || maxBlockHeight > static_cast<blocksci::BlockHeight>(chain.size())) {
+        return chain;
+    } else {
+        return {chain.begin(), chain.begin() + static_cast<int>(maxBlockHeight)};
+    }
+}
 
 template <>
 void ChainIndex<FileTag>::update(const ConfigType &config) {
     int fileNum = 0;
     unsigned int filePos = 0;
 
-    if (!blockList.empty()) {
-        fileNum = newestBlock.nFile;
-        filePos = newestBlock.nDataPos + newestBlock.size;
+    if (blockFile.size() > 0) {
+        auto newestBlock = blockFile.getData(blockFile.size() - 1);
+        fileNum = newestBlock->nFile;
+        filePos = newestBlock->nDataPos + newestBlock->size;
     }
 
     auto firstFile = fileNum;
@@ -95,6 +257,7 @@ void ChainIndex<FileTag>::update(const ConfigType &config) {
     int filesDone = 0;
     using namespace std::chrono_literals;
     std::atomic<int> activeThreads{0};
+    std::vector<BlockType> newBlockList;
     {
         std::vector<std::future<void>> blockFutures;
         for (; fileNum <= maxFileNum; fileNum++) {
@@ -144,15 +307,10 @@ void ChainIndex<FileTag>::update(const ConfigType &config) {
                     throw;
                 }
                 
-                if (fileNum == maxFileNum && blocks.size() > 0) {
-                    newestBlock = blocks.back();
-                }
                 activeThreads--;
                 std::lock_guard<std::mutex> lock(m);
                 
-                for (auto &block : blocks) {
-                    blockList[block.hash] = block;
-                }
+                newBlockList.insert(newBlockList.end(), blocks.begin(), blocks.end());
                 
                 filesDone++;
                 std::cout << "\r" << (static_cast<double>(filesDone) / static_cast<double>(fileCount)) * 100 << "% done fetching block headers" << std::flush;
@@ -163,30 +321,17 @@ void ChainIndex<FileTag>::update(const ConfigType &config) {
     
     std::cout << std::endl;
     
-    std::unordered_multimap<blocksci::uint256, blocksci::uint256> forwardHashes;
+    // Append in file order so that the last record is always the resume point for the next update
+    std::sort(newBlockList.begin(), newBlockList.end(), [](const BlockType &a, const BlockType &b) {
+        return std::make_pair(a.nFile, a.nDataPos) < std::make_pair(b.nFile, b.nDataPos);
+    });
     
-    for (auto &pair : blockList) {
-        forwardHashes.emplace(pair.second.header.hashPrevBlock, pair.second.hash);
-    }
-    
-    blocksci::uint256 nullHash;
-    nullHash.SetNull();
-    
-    std::vector<std::pair<blocksci::uint256, blocksci::BlockHeight>> queue;
-    
-    queue.emplace_back(nullHash, 0);
-    while (!queue.empty()) {
-        blocksci::uint256 blockHash;
-        blocksci::BlockHeight height;
-        std::tie(blockHash, height) = queue.back();
-        queue.pop_back();
-        for (auto ret = forwardHashes.equal_range(blockHash); ret.first != ret.second; ++ret.first) {
-            auto &block = blockList.at(ret.first->second);
-            block.height = height + 1;
-            queue.emplace_back(block.hash, block.height);
-        }
+    for (auto &block : newBlockList) {
+        addBlock(block);
     }
     
+    resolveHeights();
+    blockFile.clearBuffer();
 }
 
 template<>
@@ -209,16 +354,14 @@ void ChainIndex<RPCTag>::update(const ConfigType &config) {
         for (blocksci::BlockHeight i = splitPoint; i < blockHeight; i++) {
             std::string blockhash = bapi.getblockhash(static_cast<int>(i));
             BlockType block{bapi.getblock(blockhash), i};
-            blockList.emplace(block.hash, block);
+            addBlock(block);
             auto count = i - splitPoint;
             if (count % percentageMarker == 0) {
                 std::cout << "\r" << (static_cast<double>(static_cast<int>(count)) / static_cast<double>(static_cast<int>(numBlocks))) * 100 << "% done fetching block headers" << std::flush;
             }
-            if (i == blockHeight - 1) {
-                newestBlock = block;
-            }
         }
         
+        blockFile.clearBuffer();
         std::cout << std::endl;
     } catch (const BitcoinException &e) {
         std::cout << std::endl;
@@ -228,4 +371,7 @@ void ChainIndex<RPCTag>::update(const ConfigType &config) {
     std::cout << std::endl;
 }
 
+template struct ChainIndex<FileTag>;
+template struct ChainIndex<RPCTag>;
+
 #endif
@@ -14,29 +14,21 @@
 
 #include <blocksci/util/bitcoin_uint256.hpp>
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/util/file_mapper.hpp>
 
-#include <boost/serialization/base_object.hpp>
+#include <range/v3/utility/optional.hpp>
 
 #include <unordered_map>
 #include <algorithm>
 #include <vector>
 #include <cstdint>
 #include <limits>
+#include <type_traits>
 
 class CBlockIndex;
 struct blockinfo_t;
 
 struct CBlockHeader {
-    friend class boost::serialization::access;
-    template<class Archive> void serialize(Archive & ar, const unsigned int) {
-        ar & nVersion;
-        ar & hashPrevBlock;
-        ar & hashMerkleRoot;
-        ar & nTime;
-        ar & nBits;
-        ar & nNonce;
-    }
-    
     // header
     int32_t nVersion;
     blocksci::uint256 hashPrevBlock;
@@ -66,19 +58,6 @@ struct BlockInfoBase {
     
     BlockInfoBase() {}
     BlockInfoBase(const blocksci::uint256 &hash, const CBlockHeader &h, uint32_t size, unsigned int numTxes, uint32_t inputCount, uint32_t outputCount);
-    
-    friend class boost::serialization::access;
-    template<class Archive> void serialize(Archive & ar, const unsigned int) {
-        ar & hash;
-        ar & header;
-        ar & height;
-        ar & size;
-        ar & nTx;
-        ar & inputCount;
-        ar & outputCount;
-    }
-    
-    
 };
 
 template <typename ParseType>
@@ -95,13 +74,6 @@ struct BlockInfo<FileTag> : BlockInfoBase {
     
     BlockInfo() : BlockInfoBase() {}
     BlockInfo(const CBlockHeader &h, uint32_t length, unsigned int numTxes, uint32_t inputCount, uint32_t outputCount, const ParserConfiguration<FileTag> &config, int fileNum, unsigned int dataPos);
-    
-    friend class boost::serialization::access;
-    template<class Archive> void serialize(Archive & ar, const unsigned int) {
-        ar & boost::serialization::base_object<BlockInfoBase>(*this);
-        ar & nFile;
-        ar & nDataPos;
-    }
 };
 
 template<>
@@ -109,60 +81,46 @@ struct BlockInfo<RPCTag> : BlockInfoBase {
     std::vector<std::string> tx;
     
     BlockInfo() : BlockInfoBase() {}
+    BlockInfo(const BlockInfoBase &base) : BlockInfoBase(base) {}
     BlockInfo(const blockinfo_t &info, blocksci::BlockHeight height);
-    
-    friend class boost::serialization::access;
-    template<class Archive> void serialize(Archive & ar, const unsigned int) {
-        ar & boost::serialization::base_object<BlockInfoBase>(*this);
-        ar & tx;
-    }
 };
 
+// The on disk record stored for each block in the chain index
+template <typename ParseTag>
+struct BlockIndexRecord {
+    using type = BlockInfo<ParseTag>;
+};
+
+// Transaction ids are not persisted for RPC blocks. They are refetched if a block must be processed in a later run
+template <>
+struct BlockIndexRecord<RPCTag> {
+    using type = BlockInfoBase;
+};
+
+/* The chain index is an append only file of fixed size block records paired with an open addressing hash
+ * table mapping block hashes to record numbers. Both files are memory mapped so loading the index is free
+ * and an incremental update only needs to write the headers of newly seen blocks.
+ */
 template <typename ParseTag>
 struct ChainIndex {
     using BlockType = BlockInfo<ParseTag>;
+    using RecordType = typename BlockIndexRecord<ParseTag>::type;
     using ConfigType = ParserConfiguration<ParseTag>;
-    std::unordered_map<blocksci::uint256, BlockType> blockList;
-    BlockType newestBlock;
+    
+    static_assert(std::is_trivially_copyable<RecordType>::value, "Chain index records must be trivially copyable");
+    
+    ChainIndex(const ParserConfigurationBase &config);
     
     void update(const ConfigType &config);
-
-    std::vector<BlockType> generateChain(blocksci::BlockHeight maxBlockHeight) const {
-        std::vector<BlockType> chain;
-        const BlockType *maxHeightBlock = nullptr;
-        blocksci::BlockHeight maxHeight = std::numeric_limits<blocksci::BlockHeight>::min();
-        for (auto &pair : blockList) {
-            if (pair.second.height > maxHeight) {
-                maxHeightBlock = &pair.second;
-                maxHeight = pair.second.height;
-            }
-        }
-        
-        if (!maxHeightBlock) {
-            return chain;
-        }
-        
-        blocksci::uint256 nullHash;
-        nullHash.SetNull();
-        
-        auto hash = maxHeightBlock->hash;
-        
-        while (hash != nullHash) {
-            auto &block = blockList.find(hash)->second;
-            chain.push_back(block);
-            hash = block.header.hashPrevBlock;
-        }
-        
-        std::reverse(chain.begin(), chain.end());
-        if (maxBlockHeight < 0) {
-            return {chain.begin(), chain.end() + static_cast<int>(maxBlockHeight)};
-        } else if (maxBlockHeight == 0 || maxBlockHeight > static_cast<blocksci::BlockHeight>(chain.size())) {
-            return chain;
-        } else {
-            return {chain.begin(), chain.begin() + static_cast<int>(maxBlockHeight)};
-        }
+    
+    size_t size() const {
+        return blockFile.size();
     }
     
+    ranges::optional<uint32_t> findBlock(const blocksci::uint256 &hash) const;
+    
+    std::vector<BlockType> generateChain(blocksci::BlockHeight maxBlockHeight) const;
+    
     template <typename GetBlockHash>
     blocksci::BlockHeight findSplitPointIndex(blocksci::BlockHeight blockHeight, GetBlockHash getBlockHash) {
         auto oldBlocks = generateChain(blockHeight);
@@ -181,10 +139,16 @@ struct ChainIndex {
     }
     
 private:
-    friend class boost::serialization::access;
-    template<class Archive> void serialize(Archive & ar, const unsigned int);
+    blocksci::FixedSizeFileMapper<RecordType, blocksci::AccessMode::readwrite> blockFile;
+    blocksci::FixedSizeFileMapper<uint32_t, blocksci::AccessMode::readwrite> hashTable;
+    
+    // Full block info for blocks added during this run whose records drop data (RPC transaction ids)
+    std::unordered_map<blocksci::uint256, BlockType> newBlocks;
     
-    int updateHeight(size_t blockNum, const std::unordered_map<blocksci::uint256, size_t> &indexMap);
+    bool addBlock(const BlockType &block);
+    void insertHash(const blocksci::uint256 &hash, uint32_t blockNum);
+    void rebuildHashTable(size_t capacity);
+    void resolveHeights();
 };
 
 #endif /* data_store_hpp */
@@ -18,12 +18,19 @@
 #include "address_db.hpp"
 #include "parser_index_creator.hpp"
 #include "hash_index_creator.hpp"
+#include "address_prefix_index_creator.hpp"
+#include "balance_log_creator.hpp"
+#include "utxo_snapshot_creator.hpp"
+#include "nested_equiv_index_creator.hpp"
 #include "block_replayer.hpp"
 #include "address_writer.hpp"
 #include "utxo_address_state.hpp"
+#include "file_writer.hpp"
+#include "progress_bar.hpp"
 
 #include <blocksci/util/state.hpp>
 #include <blocksci/address/address_types.hpp>
+#include <blocksci/chain/algorithms.hpp>
 #include <blocksci/chain/chain_access.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
@@ -43,15 +50,168 @@
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-
+#include <algorithm>
 #include <unordered_set>
 #include <future>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
 
+// Fills in the tx height column for data parsed before it existed
+void backfillTxHeights(const ParserConfigurationBase &config) {
+    using namespace blocksci;
+    
+    FixedSizeFileMapper<RawBlock> blockFile(config.blockFilePath());
+    FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> txHeightsFile(config.txHeightsFilePath());
+    auto existingCount = static_cast<uint32_t>(txHeightsFile.size());
+    for (size_t i = 0; i < blockFile.size(); i++) {
+        auto block = blockFile.getData(i);
+        for (uint32_t txNum = std::max(block->firstTxIndex, existingCount); txNum < block->firstTxIndex + block->numTxes; txNum++) {
+            txHeightsFile.write(static_cast<BlockHeight>(i));
+        }
+    }
+}
+
+// Moves the dense sequence numbers written by older parsers into the sparse sequence file
+void convertSequenceNumbers(const ParserConfigurationBase &config) {
+    using namespace blocksci;
+    
+    auto denseIndexPath = boost::filesystem::path(config.sequenceFilePath()).concat("_index.dat");
+    auto denseDataPath = boost::filesystem::path(config.sequenceFilePath()).concat("_data.dat");
+    if (!boost::filesystem::exists(denseIndexPath)) {
+        return;
+    }
+    
+    {
+        IndexedFileMapper<AccessMode::readonly, RawTransaction> txFile(config.txFilePath());
+        IndexedFileMapper<AccessMode::readonly, uint32_t> sequenceFile(config.sequenceFilePath());
+        FixedSizeFileMapper<SparseSequenceNum, AccessMode::readwrite> sparseSequenceFile(config.sparseSequenceFilePath());
+        
+        // Start over if an earlier conversion was interrupted. The dense file isn't truncated on rollback, so stop at the tx count
+        sparseSequenceFile.truncate(0);
+        auto txCount = static_cast<uint32_t>(std::min(txFile.size(), sequenceFile.size()));
+        std::cout << "Converting sequence numbers" << std::endl;
+        auto progressBar = makeProgressBar(txCount, [=]() {});
+        for (uint32_t txNum = 0; txNum < txCount; txNum++) {
+            auto sequenceNums = sequenceFile.getData(txNum);
+            auto inputCount = txFile.getData(txNum)->inputCount;
+            for (uint32_t i = 0; i < inputCount; i++) {
+                if (sequenceNums[i] != defaultSequenceNum) {
+                    sparseSequenceFile.write(SparseSequenceNum{txNum, i, sequenceNums[i]});
+                }
+            }
+            progressBar.update(txNum);
+        }
+    }
+    
+    boost::filesystem::remove(denseIndexPath);
+    boost::filesystem::remove(denseDataPath);
+}
+
+// Fills in the spending input column for data parsed before it existed
+void backfillSpendingInputs(const ParserConfigurationBase &config) {
+    using namespace blocksci;
+    
+    IndexedFileMapper<AccessMode::readonly, RawTransaction> txFile(config.txFilePath());
+    auto txCount = static_cast<uint32_t>(txFile.size());
+    uint32_t firstMissing = 0;
+    {
+        IndexedFileWriter<1> spendingInputWriter(config.spendingInputFilePath());
+        firstMissing = static_cast<uint32_t>(spendingInputWriter.size());
+        for (uint32_t txNum = firstMissing; txNum < txCount; txNum++) {
+            spendingInputWriter.writeIndexGroup();
+            for (uint16_t i = 0; i < txFile.getData(txNum)->outputCount; i++) {
+                spendingInputWriter.write(unknownSpendingInput);
+            }
+        }
+    }
+    
+    if (firstMissing >= txCount) {
+        return;
+    }
+    
+    std::cout << "Recording spending inputs" << std::endl;
+    IndexedFileMapper<AccessMode::readwrite, uint16_t> spendingInputFile(config.spendingInputFilePath());
+    auto progressBar = makeProgressBar(txCount - firstMissing, [=]() {});
+    for (uint32_t txNum = firstMissing; txNum < txCount; txNum++) {
+        auto tx = txFile.getData(txNum);
+        auto outputNums = spentOutputNums(*tx, txNum, [&](uint32_t spentTxNum) { return txFile.getData(spentTxNum); });
+        for (uint16_t i = 0; i < tx->inputCount; i++) {
+            // Inputs that can't be told apart are left for Output::getSpendingInputPointer to search
+            if (outputNums[i] != unknownSpendingInput) {
+                spendingInputFile.getDataAtIndex(tx->getInput(i).linkedTxNum)[outputNums[i]] = i;
+            }
+        }
+        progressBar.update(txNum - firstMissing);
+    }
+}
+
+// Appends the fee and value columns of every transaction that doesn't have them yet
+void recordTxValues(const ParserConfigurationBase &config) {
+    using namespace blocksci;
+    
+    FixedSizeFileMapper<uint64_t, AccessMode::readwrite> txFeesFile(config.txFeesFilePath());
+    FixedSizeFileMapper<uint64_t, AccessMode::readwrite> txInputValuesFile(config.txInputValuesFilePath());
+    FixedSizeFileMapper<uint64_t, AccessMode::readwrite> txOutputValuesFile(config.txOutputValuesFilePath());
+    IndexedFileMapper<AccessMode::readonly, RawTransaction> txFile(config.txFilePath());
+    
+    // The columns are written together, so a size mismatch means an earlier run was interrupted
+    auto firstMissing = std::min({txFeesFile.size(), txInputValuesFile.size(), txOutputValuesFile.size()});
+    txFeesFile.truncate(firstMissing);
+    txInputValuesFile.truncate(firstMissing);
+    txOutputValuesFile.truncate(firstMissing);
+    
+    auto txCount = txFile.size();
+    if (firstMissing >= txCount) {
+        return;
+    }
+    
+    std::cout << "Recording transaction values" << std::endl;
+    auto progressBar = makeProgressBar(txCount - firstMissing, [=]() {});
+    auto pos = reinterpret_cast<const char *>(txFile.getData(firstMissing));
+    for (size_t txNum = firstMissing; txNum < txCount; txNum++) {
+        auto tx = reinterpret_cast<const RawTransaction *>(pos);
+        // Same helpers that compute the values when the columns are missing
+        txFeesFile.write(fee(*tx));
+        txInputValuesFile.write(inputValue(*tx));
+        txOutputValuesFile.write(outputValue(*tx));
+        pos += tx->serializedSize();
+        progressBar.update(txNum - firstMissing);
+    }
+}
+
+// Appends the stats of every block that doesn't have them yet. Input values are only known once the utxos have been
+// connected, so this runs as a pass over the finished transaction data rather than inside the block processor
+void recordBlockStats(const ParserConfigurationBase &config) {
+    using namespace blocksci;
+    
+    FixedSizeFileMapper<RawBlock> blockFile(config.blockFilePath());
+    FixedSizeFileMapper<RawBlockStats, AccessMode::readwrite> blockStatsFile(config.blockStatsFilePath());
+    auto blockCount = blockFile.size();
+    auto firstMissing = blockStatsFile.size();
+    if (firstMissing >= blockCount) {
+        return;
+    }
+    
+    IndexedFileMapper<AccessMode::readonly, RawTransaction> txFile(config.txFilePath());
+    std::cout << "Recording block stats" << std::endl;
+    auto progressBar = makeProgressBar(blockCount - firstMissing, [=]() {});
+    for (size_t i = firstMissing; i < blockCount; i++) {
+        auto block = blockFile.getData(i);
+        RawBlockStats stats;
+        if (block->numTxes > 0) {
+            auto pos = reinterpret_cast<const char *>(txFile.getData(block->firstTxIndex));
+            for (uint32_t j = 0; j < block->numTxes; j++) {
+                auto tx = reinterpret_cast<const RawTransaction *>(pos);
+                stats.addTransaction(*tx);
+                pos += tx->serializedSize();
+            }
+        }
+        blockStatsFile.write(stats);
+        progressBar.update(i - firstMissing);
+    }
+}
+
 std::vector<char> HexToBytes(const std::string& hex);
 uint32_t getStartingTxCount(const blocksci::DataConfiguration &config);
 
@@ -63,6 +223,7 @@ blocksci::State rollbackState(const ParserConfigurationBase &config, blocksci::B
     
     blocksci::IndexedFileMapper<blocksci::AccessMode::readwrite, blocksci::RawTransaction> txFile{config.txFilePath()};
     blocksci::FixedSizeFileMapper<blocksci::uint256, blocksci::AccessMode::readwrite> txHashesFile{config.txHashesFilePath()};
+    blocksci::IndexedFileMapper<blocksci::AccessMode::readwrite, uint16_t> spendingInputFile{config.spendingInputFilePath()};
     blocksci::DataAccess access(config);
     
     UTXOState utxoState;
@@ -103,6 +264,9 @@ blocksci::State rollbackState(const ParserConfigurationBase &config, blocksci::B
                 auto &output = spentTx->getOutput(j);
                 if (output.linkedTxNum == txNum) {
                     output.linkedTxNum = 0;
+                    if (spentTxNum < spendingInputFile.size()) {
+                        spendingInputFile.getDataAtIndex(spentTxNum)[j] = blocksci::unknownSpendingInput;
+                    }
                     UTXO utxo(output.getValue(), spentTxNum, output.getType());
                     utxoState.add({*spentHash, j}, utxo);
                     blocksci::AnyScript script(output.toAddressNum, output.getType(), access);
@@ -122,6 +286,24 @@ blocksci::State rollbackState(const ParserConfigurationBase &config, blocksci::B
     return state;
 }
 
+// Readers compare the epoch with the one they loaded, so it must change before any block data is removed
+void advanceChainEpoch(const ParserConfigurationBase &config) {
+    blocksci::FixedSizeFileMapper<uint64_t, blocksci::AccessMode::readwrite> chainEpochFile(config.chainEpochFilePath());
+    if (chainEpochFile.size() == 0) {
+        chainEpochFile.write(1);
+    } else {
+        (*chainEpochFile.getData(0))++;
+    }
+}
+
+// Gives data parsed before any rollback an epoch, so readers never have to fall back to comparing block hashes
+void createChainEpoch(const ParserConfigurationBase &config) {
+    blocksci::FixedSizeFileMapper<uint64_t, blocksci::AccessMode::readwrite> chainEpochFile(config.chainEpochFilePath());
+    if (chainEpochFile.size() == 0) {
+        chainEpochFile.write(0);
+    }
+}
+
 void rollbackTransactions(blocksci::BlockHeight blockKeepCount, const ParserConfigurationBase &config) {
     using namespace blocksci;
     
@@ -134,18 +316,45 @@ void rollbackTransactions(blocksci::BlockHeight blockKeepCount, const ParserConf
         auto firstDeletedBlock = blockFile.getData(blockKeepSize);
         auto firstDeletedTxNum = firstDeletedBlock->firstTxIndex;
         
+        advanceChainEpoch(config);
+        
         auto blocksciState = rollbackState(config, blockKeepCount, firstDeletedTxNum);
         
         blocksci::IndexedFileMapper<readwrite, blocksci::RawTransaction>(config.txFilePath()).truncate(firstDeletedTxNum);
         blocksci::FixedSizeFileMapper<blocksci::uint256, readwrite>(config.txHashesFilePath()).truncate(firstDeletedTxNum);
-        blocksci::IndexedFileMapper<readwrite, uint32_t>(config.sequenceFilePath()).truncate(firstDeletedTxNum);
+        blocksci::FixedSizeFileMapper<blocksci::BlockHeight, readwrite>(config.txHeightsFilePath()).truncate(firstDeletedTxNum);
+        for (auto &columnPath : {config.txFeesFilePath(), config.txInputValuesFilePath(), config.txOutputValuesFilePath()}) {
+            blocksci::FixedSizeFileMapper<uint64_t, readwrite> column(columnPath);
+            if (column.size() > firstDeletedTxNum) {
+                column.truncate(firstDeletedTxNum);
+            }
+        }
+        {
+            blocksci::FixedSizeFileMapper<blocksci::SparseSequenceNum, readwrite> sparseSequenceFile(config.sparseSequenceFilePath());
+            auto keepCount = sparseSequenceFile.size();
+            while (keepCount > 0 && sparseSequenceFile.getData(keepCount - 1)->txNum >= firstDeletedTxNum) {
+                keepCount--;
+            }
+            sparseSequenceFile.truncate(keepCount);
+        }
+        blocksci::IndexedFileMapper<readwrite, uint16_t>(config.spendingInputFilePath()).truncate(firstDeletedTxNum);
         blocksci::SimpleFileMapper<readwrite>(config.blockCoinbaseFilePath()).truncate(firstDeletedBlock->coinbaseOffset);
+        {
+            blocksci::FixedSizeFileMapper<blocksci::RawBlockStats, readwrite> blockStatsFile(config.blockStatsFilePath());
+            if (blockStatsFile.size() > blockKeepSize) {
+                blockStatsFile.truncate(blockKeepSize);
+            }
+        }
         blockFile.truncate(blockKeepSize);
         
         AddressState{config.addressPath(), config.hashIndexFilePath()}.rollback(blocksciState);
         AddressWriter(config).rollback(blocksciState);
         AddressDB(config, config.addressDBFilePath().native()).rollback(blocksciState);
         HashIndexCreator(config, config.hashIndexFilePath().native()).rollback(blocksciState);
+        AddressPrefixIndexCreator(config).rollback(blocksciState);
+        BalanceLogCreator(config).rollback(blockKeepCount);
+        UTXOSnapshotCreator(config, 0).rollback(blockKeepCount);
+        NestedEquivIndexCreator(config).rollback(blockKeepCount);
     }
 }
 
@@ -182,18 +391,9 @@ void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHe
     using namespace std::chrono_literals;
     
     auto chainBlocks = [&]() {
-        ChainIndex<ParserTag> index;
-        boost::filesystem::ifstream inFile(config.blockListPath(), std::ios::binary);
-        if (inFile.good()) {
-            boost::archive::binary_iarchive ia(inFile);
-            ia >> index;
-        }
+        ChainIndex<ParserTag> index(config);
         index.update(config);
-        auto blocks = index.generateChain(maxBlockNum);
-        boost::filesystem::ofstream of(config.blockListPath(), std::ios::binary);
-        boost::archive::binary_oarchive oa(of);
-        oa << index;
-        return blocks;
+        return index.generateChain(maxBlockNum);
     }();
 
     blocksci::BlockHeight splitPoint = [&]() {
@@ -221,8 +421,14 @@ void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHe
     std::ios::sync_with_stdio(false);
     
     rollbackTransactions(splitPoint, config);
+    createChainEpoch(config);
+    convertSequenceNumbers(config);
+    backfillTxHeights(config);
+    backfillSpendingInputs(config);
     
     if (blocksToAdd.size() == 0) {
+        recordTxValues(config);
+        recordBlockStats(config);
         return;
     }
     
@@ -270,6 +476,9 @@ void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHe
         utxoState.serialize(config.utxoCacheFile().native());
         utxoScriptState.serialize(config.utxoScriptStatePath().native());
     }
+    
+    recordTxValues(config);
+    recordBlockStats(config);
 }
 
 void updateHashDB(const ParserConfigurationBase &config) {
@@ -300,6 +509,35 @@ void updateAddressDB(const ParserConfigurationBase &config) {
     db.tearDown();
 }
 
+// The prefix index is optional, so routine updates only maintain it once it has been created
+void updatePrefixIndex(const ParserConfigurationBase &config, bool create) {
+    AddressPrefixIndexCreator creator(config);
+    if (create || creator.exists()) {
+        creator.update();
+    }
+}
+
+void updateBalanceLog(const ParserConfigurationBase &config, bool create) {
+    BalanceLogCreator creator(config);
+    if (create || creator.exists()) {
+        creator.update();
+    }
+}
+
+void updateUTXOSnapshots(const ParserConfigurationBase &config, bool create, uint32_t interval) {
+    UTXOSnapshotCreator creator(config, interval);
+    if (create || creator.exists()) {
+        creator.update();
+    }
+}
+
+void updateNestedEquivIndex(const ParserConfigurationBase &config, bool create) {
+    NestedEquivIndexCreator creator(config);
+    if (create || creator.exists()) {
+        creator.update();
+    }
+}
+
 void updateConfig(boost::filesystem::path &dataDirectory) {
     auto configFile = dataDirectory/"config.ini";
     
@@ -312,7 +550,7 @@ void updateConfig(boost::filesystem::path &dataDirectory) {
 
 int main(int argc, char * argv[]) {
     
-    enum class mode {update, updateCore, updateIndexes, updateHashIndex, updateAddressIndex, help};
+    enum class mode {update, updateCore, updateIndexes, updateHashIndex, updateAddressIndex, updatePrefixIndex, updateBalanceLog, updateUTXOSnapshots, updateNestedEquivIndex, help};
     mode selected = mode::help;
 
 
@@ -332,12 +570,18 @@ int main(int argc, char * argv[]) {
     std::string password;
     std::string address = "127.0.0.1";
     int port = 9998;
+    int rpcConnections = 4;
+    int rpcLookahead = 32;
+    bool rpcRawBlocks = false;
     auto rpcOptions = (
         clipp::command("rpc").set(selectedUpdateMode, updateMode::rpc),
         (clipp::required("--username") & clipp::value("username", username)) % "RPC username",
         (clipp::required("--password") & clipp::value("password", password)) % "RPC password",
         (clipp::option("--address") & clipp::value("address", address)) % "RPC address",
-        (clipp::option("--port") & clipp::value("port", port)) % "RPC port"
+        (clipp::option("--port") & clipp::value("port", port)) % "RPC port",
+        (clipp::option("--connections") & clipp::value("connections", rpcConnections)) % "Number of parallel RPC connections used to fetch blocks",
+        (clipp::option("--lookahead") & clipp::value("lookahead", rpcLookahead)) % "Maximum number of blocks to fetch ahead of the parser",
+        clipp::option("--raw-blocks").set(rpcRawBlocks) % "Fetch serialized blocks and decode them like the disk parser"
     ).doc("RPC options");
 
     std::string bitcoinDirectoryString;
@@ -351,13 +595,22 @@ int main(int argc, char * argv[]) {
     auto indexUpdateCommand = clipp::command("index-update").set(selected,mode::updateIndexes) % "Update indexes to latest chain state";
     auto addressIndexUpdateCommand = clipp::command("address-index-update").set(selected,mode::updateAddressIndex) % "Update address index to latest state";
     auto hashIndexUpdateCommand = clipp::command("hash-index-update").set(selected,mode::updateHashIndex) % "Update hash index to latest state";
+    auto prefixIndexUpdateCommand = clipp::command("prefix-index-update").set(selected,mode::updatePrefixIndex) % "Build or update the address prefix index";
+    auto balanceLogUpdateCommand = clipp::command("balance-log-update").set(selected,mode::updateBalanceLog) % "Build or update the address balance log";
+    int snapshotInterval = 0;
+    auto utxoSnapshotUpdateCommand = (
+        clipp::command("utxo-snapshot-update").set(selected,mode::updateUTXOSnapshots) % "Build or update the UTXO set snapshots",
+        (clipp::option("--interval") & clipp::value("interval", snapshotInterval)) % "Blocks between UTXO set snapshots. Each snapshot is a full copy of the UTXO set (24 bytes per output, several GB on mainnet). Changing it rebuilds them (Defaults to the current interval, or 50000 on the first build)"
+    );
+    
+    auto nestedEquivIndexUpdateCommand = clipp::command("nested-equiv-index-update").set(selected,mode::updateNestedEquivIndex) % "Build or update the nested address equivalence index";
     
     int maxBlockNum = 0;
     auto maxBlockOpt = (clipp::option("--max-block", "-m") & clipp::value("max block", maxBlockNum)) % "Max block height to scan up to";
     
     auto coreUpdateOptions = (maxBlockOpt, (fileOptions | rpcOptions));
     
-    auto commands = ((updateCommand | updateCoreCommand), coreUpdateOptions) | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand;
+    auto commands = ((updateCommand | updateCoreCommand), coreUpdateOptions) | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand | prefixIndexUpdateCommand | balanceLogUpdateCommand | utxoSnapshotUpdateCommand | nestedEquivIndexUpdateCommand;
     
     auto cli = (outputDirOpt, commands);
     
@@ -395,6 +648,9 @@ int main(int argc, char * argv[]) {
 
                 case updateMode::rpc: {
                     ParserConfiguration<RPCTag> config(username, password, address, port, dataDirectory);
+                    config.connectionCount = rpcConnections;
+                    config.blockLookahead = rpcLookahead;
+                    config.rawBlocks = rpcRawBlocks;
                     updateChain(config, blocksci::BlockHeight{maxBlockNum});
                     
                     break;
@@ -406,6 +662,10 @@ int main(int argc, char * argv[]) {
                 ParserConfigurationBase config{dataDirectory};
                 updateHashDB(config);
                 updateAddressDB(config);
+                updatePrefixIndex(config, false);
+                updateBalanceLog(config, false);
+                updateUTXOSnapshots(config, false, 0);
+                updateNestedEquivIndex(config, false);
             }
             
             break;
@@ -415,6 +675,10 @@ int main(int argc, char * argv[]) {
             ParserConfigurationBase config{dataDirectory};
             updateAddressDB(config);
             updateHashDB(config);
+            updatePrefixIndex(config, false);
+            updateBalanceLog(config, false);
+            updateUTXOSnapshots(config, false, 0);
+            updateNestedEquivIndex(config, false);
             break;
         }
 
@@ -430,6 +694,34 @@ int main(int argc, char * argv[]) {
             break;
         }
 
+        case mode::updatePrefixIndex: {
+            ParserConfigurationBase config{dataDirectory};
+            updatePrefixIndex(config, true);
+            break;
+        }
+
+        case mode::updateBalanceLog: {
+            ParserConfigurationBase config{dataDirectory};
+            updateBalanceLog(config, true);
+            break;
+        }
+
+        case mode::updateUTXOSnapshots: {
+            if (snapshotInterval < 0) {
+                std::cout << "Snapshot interval must not be negative\n";
+                return 1;
+            }
+            ParserConfigurationBase config{dataDirectory};
+            updateUTXOSnapshots(config, true, static_cast<uint32_t>(snapshotInterval));
+            break;
+        }
+
+        case mode::updateNestedEquivIndex: {
+            ParserConfigurationBase config{dataDirectory};
+            updateNestedEquivIndex(config, true);
+            break;
+        }
+
         case mode::help: {
             std::cout << clipp::make_man_page(cli, "blocksci_parser");
             break;
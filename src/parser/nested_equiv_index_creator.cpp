@@ -0,0 +1,213 @@
+//
+//  nested_equiv_index_creator.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "nested_equiv_index_creator.hpp"
+#include "file_writer.hpp"
+
+#include <blocksci/address/address_info.hpp>
+#include <blocksci/address/dedup_address.hpp>
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/index/nested_equiv_index.hpp>
+#include <blocksci/scripts/script_access.hpp>
+#include <blocksci/scripts/script_data.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/file_mapper.hpp>
+#include <blocksci/util/parallel.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using blocksci::DedupAddress;
+using blocksci::DedupAddressType;
+using blocksci::NestedEquivIndex;
+
+namespace {
+    // Dedup addresses packed with the type in the high bits so that sorting orders them by type and script number
+    uint64_t packAddress(DedupAddressType::Enum type, uint32_t scriptNum) {
+        return (static_cast<uint64_t>(type) << 32) | scriptNum;
+    }
+    
+    DedupAddress unpackAddress(uint64_t key) {
+        return DedupAddress{static_cast<uint32_t>(key), static_cast<DedupAddressType::Enum>(key >> 32)};
+    }
+    
+    boost::filesystem::path datPath(boost::filesystem::path path) {
+        return path.concat(".dat");
+    }
+    
+    boost::filesystem::path newPath(const boost::filesystem::path &path) {
+        return boost::filesystem::path{path}.concat("_new");
+    }
+    
+    void replaceFile(const boost::filesystem::path &path) {
+        boost::filesystem::rename(datPath(newPath(path)), datPath(path));
+    }
+    
+    uint32_t findRoot(std::vector<uint32_t> &parents, uint32_t node) {
+        while (parents[node] != node) {
+            parents[node] = parents[parents[node]];
+            node = parents[node];
+        }
+        return node;
+    }
+}
+
+NestedEquivIndexCreator::NestedEquivIndexCreator(const ParserConfigurationBase &config_) : config(config_) {}
+
+bool NestedEquivIndexCreator::exists() const {
+    return boost::filesystem::exists(config.nestedEquivIndexDirectory());
+}
+
+void NestedEquivIndexCreator::update() {
+    using namespace blocksci;
+    
+    boost::filesystem::create_directories(config.nestedEquivIndexDirectory());
+    DataAccess access(config);
+    
+    auto blockCount = access.chain->blockCount();
+    {
+        FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> progressFile(NestedEquivIndex::progressPath(config));
+        if (progressFile.size() == 1 && *progressFile.getData(0) == blockCount) {
+            return;
+        }
+        // Readers fall back to searching the address index while the files are replaced
+        if (progressFile.size() > 0) {
+            progressFile.truncate(0);
+        }
+    }
+    
+    std::cout << "Updating nested equivalence index\n";
+    
+    auto scriptHashCount = access.scripts->scriptCount(DedupAddressType::SCRIPTHASH);
+    auto accumulate = [&](std::vector<std::pair<uint64_t, uint64_t>> &edges, uint64_t chunkBegin, uint64_t chunkEnd) {
+        for (auto scriptNum = chunkBegin; scriptNum < chunkEnd; scriptNum++) {
+            auto data = access.scripts->getScriptData<DedupAddressType::SCRIPTHASH>(static_cast<uint32_t>(scriptNum));
+            auto wrapped = data->wrappedAddress;
+            if (wrapped.scriptNum != 0) {
+                edges.emplace_back(packAddress(DedupAddressType::SCRIPTHASH, static_cast<uint32_t>(scriptNum)), packAddress(dedupType(wrapped.type), wrapped.scriptNum));
+            }
+        }
+    };
+    auto combine = [](std::vector<std::pair<uint64_t, uint64_t>> &edges, std::vector<std::pair<uint64_t, uint64_t>> &chunkEdges) {
+        edges.insert(edges.end(), chunkEdges.begin(), chunkEdges.end());
+    };
+    auto edges = parallelReduceChunks(getThreadPool(config.threadCount), 1, uint64_t{scriptHashCount} + 1, std::vector<std::pair<uint64_t, uint64_t>>{}, accumulate, combine);
+    
+    // Only addresses touched by an edge can share a component, so the union-find runs over those alone
+    std::vector<uint64_t> nodes;
+    nodes.reserve(edges.size() * 2);
+    for (auto &edge : edges) {
+        nodes.push_back(edge.first);
+        nodes.push_back(edge.second);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    auto nodeIndex = [&](uint64_t key) {
+        return static_cast<uint32_t>(std::lower_bound(nodes.begin(), nodes.end(), key) - nodes.begin());
+    };
+    
+    std::vector<uint32_t> parents(nodes.size());
+    for (uint32_t i = 0; i < parents.size(); i++) {
+        parents[i] = i;
+    }
+    for (auto &edge : edges) {
+        auto a = findRoot(parents, nodeIndex(edge.first));
+        auto b = findRoot(parents, nodeIndex(edge.second));
+        if (a != b) {
+            parents[std::max(a, b)] = std::min(a, b);
+        }
+    }
+    edges.clear();
+    edges.shrink_to_fit();
+    
+    // Components are numbered from 1 in the order of their first member, and members are grouped by a counting sort
+    std::vector<uint32_t> componentOfRoot(nodes.size(), 0);
+    std::vector<uint32_t> nodeComponents(nodes.size());
+    std::vector<uint64_t> offsets{0};
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        auto root = findRoot(parents, i);
+        if (componentOfRoot[root] == 0) {
+            componentOfRoot[root] = static_cast<uint32_t>(offsets.size());
+            offsets.push_back(0);
+        }
+        nodeComponents[i] = componentOfRoot[root];
+        offsets[nodeComponents[i]]++;
+    }
+    for (size_t i = 1; i < offsets.size(); i++) {
+        offsets[i] += offsets[i - 1];
+    }
+    std::vector<DedupAddress> members(nodes.size());
+    {
+        auto positions = offsets;
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            members[positions[nodeComponents[i] - 1]++] = unpackAddress(nodes[i]);
+        }
+    }
+    
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        auto type = static_cast<DedupAddressType::Enum>(i);
+        auto path = NestedEquivIndex::componentsPath(config, type);
+        boost::filesystem::remove(datPath(newPath(path)));
+        {
+            FixedSizeFileWriter<uint32_t> componentsFile(newPath(path));
+            auto scriptCount = access.scripts->scriptCount(type);
+            auto node = std::lower_bound(nodes.begin(), nodes.end(), packAddress(type, 1));
+            for (uint32_t scriptNum = 1; scriptNum <= scriptCount; scriptNum++) {
+                uint32_t component = 0;
+                if (node != nodes.end() && *node == packAddress(type, scriptNum)) {
+                    component = nodeComponents[static_cast<size_t>(node - nodes.begin())];
+                    ++node;
+                }
+                componentsFile.write(component);
+            }
+        }
+        replaceFile(path);
+    }
+    
+    auto offsetsPath = NestedEquivIndex::offsetsPath(config);
+    boost::filesystem::remove(datPath(newPath(offsetsPath)));
+    {
+        FixedSizeFileWriter<uint64_t> offsetsFile(newPath(offsetsPath));
+        for (auto offset : offsets) {
+            offsetsFile.write(offset);
+        }
+    }
+    replaceFile(offsetsPath);
+    
+    auto membersPath = NestedEquivIndex::membersPath(config);
+    boost::filesystem::remove(datPath(newPath(membersPath)));
+    {
+        FixedSizeFileWriter<DedupAddress> membersFile(newPath(membersPath));
+        for (auto &member : members) {
+            membersFile.write(member);
+        }
+    }
+    replaceFile(membersPath);
+    
+    std::cout << "Linked " << nodes.size() << " addresses into " << offsets.size() - 1 << " components\n";
+    
+    FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> progressFile(NestedEquivIndex::progressPath(config));
+    progressFile.write(blockCount);
+}
+
+void NestedEquivIndexCreator::rollback(blocksci::BlockHeight blockKeepCount) {
+    using namespace blocksci;
+    
+    if (!exists()) {
+        return;
+    }
+    
+    // Scripts removed by the rollback may still be linked, so the index is unused until it is rebuilt
+    FixedSizeFileMapper<BlockHeight, AccessMode::readwrite> progressFile(NestedEquivIndex::progressPath(config));
+    if (progressFile.size() > 0 && *progressFile.getData(0) > blockKeepCount) {
+        progressFile.truncate(0);
+    }
+}
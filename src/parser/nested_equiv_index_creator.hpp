@@ -0,0 +1,28 @@
+//
+//  nested_equiv_index_creator.hpp
+//  blocksci
+//
+
+#ifndef nested_equiv_index_creator_hpp
+#define nested_equiv_index_creator_hpp
+
+#include "parser_configuration.hpp"
+
+/* Builds the optional NestedEquivIndex. Wrapped addresses are revealed whenever a script hash output is spent,
+ * which can join components found by earlier updates, so every update links the wrapping edges of all script
+ * hashes again with a union-find over the addresses they touch.
+ */
+class NestedEquivIndexCreator {
+    ParserConfigurationBase config;
+    
+public:
+    explicit NestedEquivIndexCreator(const ParserConfigurationBase &config);
+    
+    // The index is only maintained once it has been built with nested-equiv-index-update
+    bool exists() const;
+    
+    void update();
+    void rollback(blocksci::BlockHeight blockKeepCount);
+};
+
+#endif /* nested_equiv_index_creator_hpp */
@@ -45,8 +45,12 @@ struct ParserConfigurationBase : public blocksci::DataConfiguration {
         return parserDirectory()/"address";
     }
     
-    boost::filesystem::path blockListPath() const {
-        return parserDirectory()/"blockList.dat";
+    boost::filesystem::path blockIndexFilePath() const {
+        return parserDirectory()/"blockIndex";
+    }
+    
+    boost::filesystem::path blockIndexHashesFilePath() const {
+        return parserDirectory()/"blockIndexHashes";
     }
     
     boost::filesystem::path txUpdatesFilePath() const {
@@ -85,6 +89,13 @@ struct ParserConfiguration<RPCTag> : public ParserConfigurationBase {
     std::string address;
     int port;
     
+    // Number of RPC connections used to fetch blocks in parallel
+    int connectionCount = 4;
+    // Maximum number of blocks fetched ahead of the block currently being parsed
+    int blockLookahead = 32;
+    // Fetch serialized blocks and decode them with the same code as the disk parser instead of decoding JSON transactions
+    bool rawBlocks = false;
+    
     BitcoinAPI createBitcoinAPI() const;
 };
 #endif
@@ -22,6 +22,7 @@
 
 #include <openssl/sha.h>
 
+#include <cstring>
 #include <iostream>
 
 using SequenceNum = uint32_t;
@@ -171,6 +172,43 @@ void RawTransaction::calculateHash() {
     }
 }
 
+void calculateTxHashes(const std::vector<RawTransaction *> &txes) {
+    std::vector<RawTransaction *> unhashed;
+    unhashed.reserve(txes.size());
+    size_t totalLength = 0;
+    for (auto tx : txes) {
+        if (tx->hash.IsNull()) {
+            unhashed.push_back(tx);
+            totalLength += sizeof(tx->version) + tx->txHashLength + sizeof(tx->locktime);
+        }
+    }
+    
+    // Segwit transactions are hashed without their witness data so each serialization is first made contiguous
+    std::vector<unsigned char> serialized(totalLength);
+    std::vector<const unsigned char *> messages;
+    std::vector<size_t> lengths;
+    std::vector<blocksci::uint256> hashes(unhashed.size());
+    messages.reserve(unhashed.size());
+    lengths.reserve(unhashed.size());
+    auto pos = serialized.data();
+    for (auto tx : unhashed) {
+        auto start = pos;
+        memcpy(pos, &tx->version, sizeof(tx->version));
+        pos += sizeof(tx->version);
+        memcpy(pos, tx->txHashStart, tx->txHashLength);
+        pos += tx->txHashLength;
+        memcpy(pos, &tx->locktime, sizeof(tx->locktime));
+        pos += sizeof(tx->locktime);
+        messages.push_back(start);
+        lengths.push_back(static_cast<size_t>(pos - start));
+    }
+    
+    doubleSha256Batch(messages.data(), lengths.data(), hashes.data(), hashes.size());
+    for (size_t i = 0; i < unhashed.size(); i++) {
+        unhashed[i]->hash = hashes[i];
+    }
+}
+
 #endif
 
 #ifdef BLOCKSCI_RPC_PARSER
@@ -152,5 +152,8 @@ struct RawTransaction {
     std::vector<char> getSer(const InputView &info, const blocksci::CScriptView &scriptView, int hashType) const;
 };
 
+// Fills in the hash of every transaction that doesn't have one yet, hashing them together in a single batch
+void calculateTxHashes(const std::vector<RawTransaction *> &txes);
+
 
 #endif /* preproccessed_block_hpp */
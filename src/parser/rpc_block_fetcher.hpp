@@ -0,0 +1,143 @@
+//
+//  rpc_block_fetcher.hpp
+//  blocksci
+//
+
+#ifndef rpc_block_fetcher_hpp
+#define rpc_block_fetcher_hpp
+
+#include "config.hpp"
+
+#ifdef BLOCKSCI_RPC_PARSER
+
+#include "parser_configuration.hpp"
+#include "chain_index.hpp"
+
+#include <bitcoinapi/bitcoinapi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* Fetches the data for a list of blocks over a pool of RPC connections. Each worker thread owns its own
+ * connection and claims whole blocks in order, running at most lookahead blocks ahead of the consumer so
+ * that the parser never waits on a round trip unless the node itself is the bottleneck. A block whose RPC
+ * calls fail maxAttempts times stops the fetcher, and nextBlock rethrows the error.
+ */
+template <typename BlockData>
+class RPCBlockFetcher {
+public:
+    using FetchFunc = std::function<BlockData(BitcoinAPI &bapi, const BlockInfo<RPCTag> &block)>;
+    
+    static constexpr int maxAttempts = 3;
+    // Wait before the nth retry of a block is n times this
+    static constexpr int retryDelayMs = 100;
+
+private:
+    const ParserConfiguration<RPCTag> &config;
+    const std::vector<BlockInfo<RPCTag>> &blocks;
+    FetchFunc fetchFunc;
+    size_t lookahead;
+
+    std::mutex m;
+    std::condition_variable cv;
+    size_t nextToFetch = 0;
+    size_t nextToConsume = 0;
+    bool stopped = false;
+    std::exception_ptr error;
+    std::unordered_map<size_t, BlockData> fetchedBlocks;
+    std::vector<std::thread> workers;
+
+    // Errors from a busy or restarting node usually clear up, so RPC errors are retried before giving up
+    BlockData fetchWithRetries(BitcoinAPI &bapi, const BlockInfo<RPCTag> &block) {
+        for (int attempt = 1; ; attempt++) {
+            try {
+                return fetchFunc(bapi, block);
+            } catch (const BitcoinException &) {
+                std::lock_guard<std::mutex> lock(m);
+                if (attempt >= maxAttempts || stopped) {
+                    throw;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(retryDelayMs * attempt));
+        }
+    }
+
+    void fetchLoop() {
+        BitcoinAPI bapi{config.createBitcoinAPI()};
+        while (true) {
+            size_t blockNum;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]() {
+                    return stopped || nextToFetch >= blocks.size() || nextToFetch < nextToConsume + lookahead;
+                });
+                if (stopped || nextToFetch >= blocks.size()) {
+                    return;
+                }
+                blockNum = nextToFetch++;
+            }
+
+            try {
+                auto data = fetchWithRetries(bapi, blocks[blockNum]);
+                std::lock_guard<std::mutex> lock(m);
+                fetchedBlocks.emplace(blockNum, std::move(data));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m);
+                error = std::current_exception();
+                stopped = true;
+            }
+            cv.notify_all();
+        }
+    }
+
+public:
+    RPCBlockFetcher(const ParserConfiguration<RPCTag> &config_, const std::vector<BlockInfo<RPCTag>> &blocks_, FetchFunc fetchFunc_) : config(config_), blocks(blocks_), fetchFunc(std::move(fetchFunc_)), lookahead(std::max(config.blockLookahead, 1)) {
+        auto connectionCount = std::max(config.connectionCount, 1);
+        for (int i = 0; i < connectionCount; i++) {
+            workers.emplace_back(&RPCBlockFetcher::fetchLoop, this);
+        }
+    }
+
+    RPCBlockFetcher(const RPCBlockFetcher &) = delete;
+    RPCBlockFetcher &operator=(const RPCBlockFetcher &) = delete;
+
+    ~RPCBlockFetcher() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Returns the data for the next block in order, waiting for it to arrive if necessary
+    BlockData nextBlock() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&]() {
+            return error || fetchedBlocks.find(nextToConsume) != fetchedBlocks.end();
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        auto it = fetchedBlocks.find(nextToConsume);
+        auto data = std::move(it->second);
+        fetchedBlocks.erase(it);
+        nextToConsume++;
+        lock.unlock();
+        cv.notify_all();
+        return data;
+    }
+};
+
+#endif
+
+#endif /* rpc_block_fetcher_hpp */
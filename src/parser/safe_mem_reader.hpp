@@ -29,6 +29,13 @@ public:
         end = fileMap.end();
         pos = begin;
     }
+    
+    // Reads from a buffer owned by the caller which must outlive the reader and anything pointing into it
+    SafeMemReader(const char *data, size_type size) {
+        begin = data;
+        end = data + size;
+        pos = begin;
+    }
 
     bool has(difference_type n) {
         return n <= std::distance(pos, end);
@@ -0,0 +1,202 @@
+//
+//  utxo_snapshot_creator.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "utxo_snapshot_creator.hpp"
+#include "file_writer.hpp"
+
+#include <blocksci/chain/chain_access.hpp>
+#include <blocksci/chain/raw_block.hpp>
+#include <blocksci/chain/raw_transaction.hpp>
+#include <blocksci/index/utxo_snapshots.hpp>
+#include <blocksci/util/data_access.hpp>
+#include <blocksci/util/file_mapper.hpp>
+#include <blocksci/util/parallel.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+using blocksci::BlockHeight;
+using blocksci::OutputPointer;
+using blocksci::UTXOSnapshots;
+
+namespace {
+    // Transactions whose spent outputs are collected in memory before being appended to the log
+    constexpr uint64_t windowTxCount = 1 << 22;
+    
+    // Spent outputs of consecutive blocks, with the number belonging to each block
+    struct SpentRuns {
+        std::vector<OutputPointer> spent;
+        std::vector<uint64_t> counts;
+    };
+    
+    boost::filesystem::path datPath(boost::filesystem::path path) {
+        return path.concat(".dat");
+    }
+}
+
+constexpr uint32_t UTXOSnapshotCreator::defaultInterval;
+
+UTXOSnapshotCreator::UTXOSnapshotCreator(const ParserConfigurationBase &config_, uint32_t interval) : config(config_), requestedInterval(interval) {}
+
+bool UTXOSnapshotCreator::exists() const {
+    return boost::filesystem::exists(config.utxoSnapshotDirectory());
+}
+
+void UTXOSnapshotCreator::update() {
+    using namespace blocksci;
+    
+    BlockHeight coveredCount = 0;
+    uint32_t interval = 0;
+    {
+        FixedSizeFileMapper<uint32_t> stateFile(UTXOSnapshots::statePath(config));
+        if (stateFile.size() == 2) {
+            coveredCount = static_cast<BlockHeight>(*stateFile.getData(0));
+            interval = *stateFile.getData(1);
+        }
+    }
+    if (requestedInterval != 0 && interval != 0 && requestedInterval != interval) {
+        std::cout << "Rebuilding UTXO snapshots with a new interval\n";
+        boost::filesystem::remove_all(config.utxoSnapshotDirectory());
+        coveredCount = 0;
+    }
+    if (requestedInterval != 0) {
+        interval = requestedInterval;
+    } else if (interval == 0) {
+        interval = defaultInterval;
+    }
+    boost::filesystem::create_directories(config.utxoSnapshotDirectory());
+    
+    DataAccess access(config);
+    auto &chain = *access.chain;
+    auto blockCount = chain.blockCount();
+    
+    {
+        FixedSizeFileMapper<uint64_t, AccessMode::readwrite> spentOffsetsFile(UTXOSnapshots::spentOffsetsPath(config));
+        FixedSizeFileMapper<OutputPointer, AccessMode::readwrite> spentFile(UTXOSnapshots::spentPath(config));
+        if (spentOffsetsFile.size() == 0) {
+            spentOffsetsFile.write(0);
+        }
+        
+        // Drop anything an interrupted update appended past the covered blocks
+        coveredCount = std::min({coveredCount, static_cast<BlockHeight>(spentOffsetsFile.size() - 1), blockCount});
+        spentOffsetsFile.truncate(static_cast<size_t>(coveredCount) + 1);
+        auto offset = *spentOffsetsFile.getData(static_cast<size_t>(coveredCount));
+        spentFile.truncate(offset);
+        if (coveredCount == blockCount) {
+            return;
+        }
+        
+        std::cout << "Updating UTXO snapshots with " << blockCount - coveredCount << " blocks\n";
+        
+        auto &pool = getThreadPool(config.threadCount);
+        auto windowStart = coveredCount;
+        while (windowStart < blockCount) {
+            auto windowEnd = windowStart;
+            uint64_t txCount = 0;
+            while (windowEnd < blockCount && txCount < windowTxCount) {
+                txCount += chain.getBlock(windowEnd)->numTxes;
+                windowEnd++;
+            }
+            
+            auto accumulate = [&](SpentRuns &runs, uint64_t chunkBegin, uint64_t chunkEnd) {
+                for (auto i = chunkBegin; i < chunkEnd; i++) {
+                    auto block = chain.getBlock(static_cast<BlockHeight>(i));
+                    auto runStart = runs.spent.size();
+                    for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->numTxes; txNum++) {
+                        auto tx = chain.getTx(txNum);
+                        for (uint16_t j = 0; j < tx->inputCount; j++) {
+                            // Inputs only know the spent tx, so find its outputs that link back to this one
+                            auto spentTxNum = tx->getInput(j).linkedTxNum;
+                            auto spentTx = chain.getTx(spentTxNum);
+                            for (uint16_t k = 0; k < spentTx->outputCount; k++) {
+                                if (spentTx->getOutput(k).linkedTxNum == txNum) {
+                                    runs.spent.emplace_back(spentTxNum, k);
+                                }
+                            }
+                        }
+                    }
+                    // A tx spending several outputs of the same tx finds each of them once per input
+                    auto runBegin = runs.spent.begin() + static_cast<std::ptrdiff_t>(runStart);
+                    std::sort(runBegin, runs.spent.end());
+                    runs.spent.erase(std::unique(runBegin, runs.spent.end()), runs.spent.end());
+                    runs.counts.push_back(runs.spent.size() - runStart);
+                }
+            };
+            auto combine = [](SpentRuns &runs, SpentRuns &chunkRuns) {
+                runs.spent.insert(runs.spent.end(), chunkRuns.spent.begin(), chunkRuns.spent.end());
+                runs.counts.insert(runs.counts.end(), chunkRuns.counts.begin(), chunkRuns.counts.end());
+            };
+            auto runs = parallelReduceChunks(pool, static_cast<uint64_t>(windowStart), static_cast<uint64_t>(windowEnd), SpentRuns{}, accumulate, combine);
+            
+            for (auto &pointer : runs.spent) {
+                spentFile.write(pointer);
+            }
+            for (auto count : runs.counts) {
+                offset += count;
+                spentOffsetsFile.write(offset);
+            }
+            windowStart = windowEnd;
+        }
+    }
+    
+    UTXOSnapshots snapshots(config);
+    auto snapshotInterval = static_cast<BlockHeight>(interval);
+    auto base = coveredCount - coveredCount % snapshotInterval;
+    if (base + snapshotInterval <= blockCount) {
+        auto entries = snapshots.loadSnapshot(base);
+        for (auto snapshotCount = base + snapshotInterval; snapshotCount <= blockCount; snapshotCount += snapshotInterval) {
+            snapshots.replay(entries, base, snapshotCount, chain);
+            auto snapshotPath = UTXOSnapshots::snapshotPath(config, snapshotCount);
+            auto newPath = boost::filesystem::path{snapshotPath}.concat("_new");
+            boost::filesystem::remove(datPath(newPath));
+            {
+                FixedSizeFileWriter<UTXOSetEntry> snapshotFile(newPath);
+                for (auto &entry : entries) {
+                    snapshotFile.write(entry);
+                }
+            }
+            boost::filesystem::rename(datPath(newPath), datPath(snapshotPath));
+            std::cout << "Wrote UTXO snapshot at block " << snapshotCount << " with " << entries.size() << " outputs\n";
+            base = snapshotCount;
+        }
+    }
+    
+    // Only recorded once the log and snapshots are written so that an interrupted update is redone
+    FixedSizeFileMapper<uint32_t, AccessMode::readwrite> stateFile(UTXOSnapshots::statePath(config));
+    while (stateFile.size() < 2) {
+        stateFile.write(0);
+    }
+    *stateFile.getData(0) = static_cast<uint32_t>(blockCount);
+    *stateFile.getData(1) = interval;
+}
+
+void UTXOSnapshotCreator::rollback(BlockHeight blockKeepCount) {
+    using namespace blocksci;
+    
+    if (!exists()) {
+        return;
+    }
+    
+    FixedSizeFileMapper<uint32_t, AccessMode::readwrite> stateFile(UTXOSnapshots::statePath(config));
+    if (stateFile.size() == 2) {
+        auto coveredCount = static_cast<BlockHeight>(*stateFile.getData(0));
+        auto interval = static_cast<BlockHeight>(*stateFile.getData(1));
+        for (auto snapshotCount = blockKeepCount - blockKeepCount % interval + interval; snapshotCount <= coveredCount; snapshotCount += interval) {
+            boost::filesystem::remove(datPath(UTXOSnapshots::snapshotPath(config, snapshotCount)));
+        }
+        *stateFile.getData(0) = static_cast<uint32_t>(std::min(coveredCount, blockKeepCount));
+    }
+    
+    FixedSizeFileMapper<uint64_t, AccessMode::readwrite> spentOffsetsFile(UTXOSnapshots::spentOffsetsPath(config));
+    auto keepSize = static_cast<size_t>(blockKeepCount) + 1;
+    if (spentOffsetsFile.size() > keepSize) {
+        spentOffsetsFile.truncate(keepSize);
+        FixedSizeFileMapper<OutputPointer, AccessMode::readwrite>(UTXOSnapshots::spentPath(config)).truncate(*spentOffsetsFile.getData(keepSize - 1));
+    }
+}
@@ -0,0 +1,34 @@
+//
+//  utxo_snapshot_creator.hpp
+//  blocksci
+//
+
+#ifndef utxo_snapshot_creator_hpp
+#define utxo_snapshot_creator_hpp
+
+#include "parser_configuration.hpp"
+
+/* Builds the optional UTXOSnapshots. The spent log is extended with the outputs spent by each new block, found
+ * through the inputs of the block, and the snapshots due since the last update are produced by replaying the log
+ * forward from the latest existing one.
+ */
+class UTXOSnapshotCreator {
+    ParserConfigurationBase config;
+    uint32_t requestedInterval;
+    
+public:
+    // Each snapshot is a full copy of the UTXO set at 24 bytes per output, several GB on mainnet, so the
+    // snapshots take about blockCount / interval times that. Queries replay up to interval - 1 blocks
+    static constexpr uint32_t defaultInterval = 50000;
+    
+    // An interval of 0 keeps the one the snapshots were built with
+    UTXOSnapshotCreator(const ParserConfigurationBase &config, uint32_t interval);
+    
+    // The snapshots are only maintained once they have been built with utxo-snapshot-update
+    bool exists() const;
+    
+    void update();
+    void rollback(blocksci::BlockHeight blockKeepCount);
+};
+
+#endif /* utxo_snapshot_creator_hpp */
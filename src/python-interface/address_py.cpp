@@ -13,9 +13,11 @@
 #include <blocksci/address/equiv_address.hpp>
 #include <blocksci/address/address_info.hpp>
 #include <blocksci/chain.hpp>
+#include <blocksci/chain/inout_pointer.hpp>
 #include <blocksci/script.hpp>
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 
 #include <range/v3/iterator_range.hpp>
@@ -25,6 +27,23 @@ namespace py = pybind11;
 
 using namespace blocksci;
 
+namespace {
+    py::dict balanceHistoryColumns(const std::vector<BalanceChange> &history) {
+        py::array_t<BlockHeight> heights(history.size());
+        py::array_t<uint64_t> balances(history.size());
+        auto heightData = heights.mutable_unchecked<1>();
+        auto balanceData = balances.mutable_unchecked<1>();
+        for (size_t i = 0; i < history.size(); i++) {
+            heightData(i) = history[i].height;
+            balanceData(i) = history[i].balance;
+        }
+        py::dict columns;
+        columns["height"] = heights;
+        columns["balance"] = balances;
+        return columns;
+    }
+}
+
 void init_address(py::module &m) {
     py::class_<Address> address(m, "Address", "Represents an abstract address object which uniquely identifies a given address");
     address
@@ -32,8 +51,11 @@ void init_address(py::module &m) {
     .def(hash(py::self))
     .def_readonly("address_num", &Address::scriptNum, "The internal identifier of the address")
     .def_readonly("type", &Address::type, "The type of address")
-    .def("equiv", &Address::getEquivAddresses, py::arg("equiv_script") = true, "Returns a list of all addresses equivalent to this address")
+    .def("equiv", &Address::getEquivAddresses, py::arg("equiv_script") = true, "Returns a list of all addresses equivalent to this address. With equiv_script, this includes every address linked to it through P2SH wrapping in either direction, including other P2SH addresses that wrap the same script. These are read from the nested equivalence index if it was built with the parser's nested-equiv-index-update command and found with the same search otherwise")
     .def("balance", &Address::calculateBalance, py::arg("height") = -1, "Calculates the balance held by this address at the height (Defaults to the full chain)")
+    .def("balance_history", [](const Address &address) {
+        return balanceHistoryColumns(address.balanceHistory());
+    }, "Returns a dict of numpy arrays holding each height where the balance of this address changed and the balance after that block")
     .def("outs", &Address::getOutputs, "Returns a list of all outputs sent to this address")
     .def("ins", &Address::getInputs, "Returns a list of all inputs spent from this address")
     .def("txes", &Address::getTransactions, "Returns a list of all transactions involving this address")
@@ -60,6 +82,9 @@ void init_address(py::module &m) {
         return py::make_iterator(transformed.begin(), transformed.end());
     },py::keep_alive<0, 1>())
     .def("balance", &EquivAddress::calculateBalance, py::arg("height") = -1, "Calculates the balance held by these equivalent addresses at the height (Defaults to the full chain)")
+    .def("balance_history", [](const EquivAddress &address) {
+        return balanceHistoryColumns(address.balanceHistory());
+    }, "Returns a dict of numpy arrays holding each height where the combined balance of these equivalent addresses changed and the balance after that block")
     .def("outs", &EquivAddress::getOutputs, "Returns a list of all outputs sent to these equivalent addresses")
     .def("ins", &EquivAddress::getInputs, "Returns a list of all inputs spent from these equivalent addresses")
     .def("txes", &EquivAddress::getTransactions, "Returns a list of all transactions involving these equivalent addresses")
@@ -8,16 +8,20 @@
 
 #include "variant_py.hpp"
 #include "optional_py.hpp"
+#include "chain_algorithms.hpp"
 
+#include <blocksci/address/address_encoder.hpp>
 #include <blocksci/chain/algorithms.hpp>
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/index/address_index.hpp>
 #include <blocksci/index/hash_index.hpp>
+#include <blocksci/index/utxo_snapshots.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 #include <blocksci/heuristics/blockchain_heuristics.hpp>
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
@@ -25,10 +29,39 @@
 #include <range/v3/view/slice.hpp>
 #include <range/v3/view/stride.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 namespace py = pybind11;
 
 using namespace blocksci;
 
+namespace {
+    template <typename T, typename Func>
+    py::array_t<T> blockColumn(const std::vector<RawBlockStats> &stats, Func func) {
+        py::array_t<T> column(stats.size());
+        auto data = column.template mutable_unchecked<1>();
+        for (size_t i = 0; i < stats.size(); i++) {
+            data(i) = func(stats[i]);
+        }
+        return column;
+    }
+    
+    template <typename T>
+    py::array_t<T> blockTypeColumns(const std::vector<RawBlockStats> &stats, std::array<T, AddressType::size> RawBlockStats::*field) {
+        py::array_t<T> columns(std::vector<py::ssize_t>{static_cast<py::ssize_t>(stats.size()), static_cast<py::ssize_t>(AddressType::size)});
+        auto data = columns.template mutable_unchecked<2>();
+        for (size_t i = 0; i < stats.size(); i++) {
+            auto &values = stats[i].*field;
+            for (size_t j = 0; j < AddressType::size; j++) {
+                data(i, j) = values[j];
+            }
+        }
+        return columns;
+    }
+}
+
 void init_blockchain(py::module &m) {
     
     py::class_<DataConfiguration> (m, "DataConfiguration", "This class holds the configuration data about a blockchain instance")
@@ -56,6 +89,7 @@ void init_blockchain(py::module &m) {
     .def("__iter__", [](const Blockchain &chain) { return py::make_iterator(chain.begin(), chain.end()); },
          py::keep_alive<0, 1>(), "Allows direct iteration over the blocks in the blockchain")
     .def("__getitem__", [](const Blockchain &chain, blocksci::BlockHeight i) {
+        chain.getAccess().chain->reorgCheck();
         if (i < 0) {
             i += chain.size();
         }
@@ -70,6 +104,7 @@ void init_blockchain(py::module &m) {
             throw py::error_already_set();
         return chain | ranges::view::slice(start, stop) | ranges::view::stride(step) | ranges::to_vector;
     }, "Return a list of blocks with their heights in the given range")
+    .def("refresh", &Blockchain::refresh, "Load blocks the parser has added since this chain was opened. Throws an error if blocks that were already loaded have been removed by a reorg")
     .def_property_readonly("config", [](const Blockchain &chain) -> DataConfiguration { return chain.getAccess().config; }, "Returns the configuration settings for this blockchain")
     .def("segment", segmentChain, "Divide the blockchain into the given number of chunks with roughly the same number of transactions in each")
     .def("segment_indexes", segmentChainIndexes, "Return a list of [start, end] block height pairs representing chunks with roughly the same number of transactions in each")
@@ -78,6 +113,65 @@ void init_blockchain(py::module &m) {
     .def("addresses", [](const Blockchain &chain, AddressType::Enum type) {
         return chain.scripts(type);
     })
+    .def("block_stats", [](const Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        start = std::max(start, BlockHeight{0});
+        stop = std::min(stop, chain.size());
+        std::vector<RawBlockStats> stats;
+        std::vector<Block> blocks;
+        for (BlockHeight height = start; height < stop; height++) {
+            blocks.push_back(chain[height]);
+            stats.push_back(blocks.back().stats());
+        }
+        auto blockValue = [&](auto func) {
+            py::array_t<uint32_t> column(blocks.size());
+            auto data = column.mutable_unchecked<1>();
+            for (size_t i = 0; i < blocks.size(); i++) {
+                data(i) = func(blocks[i]);
+            }
+            return column;
+        };
+        py::dict columns;
+        columns["height"] = blockValue([](const Block &block) { return static_cast<uint32_t>(block.height()); });
+        columns["tx_count"] = blockValue([](const Block &block) { return block.endTxIndex() - block.firstTxIndex(); });
+        columns["base_size"] = blockValue([](const Block &block) { return block.baseSize(); });
+        columns["total_size"] = blockValue([](const Block &block) { return block.totalSize(); });
+        columns["weight"] = blockValue([](const Block &block) { return block.weight(); });
+        columns["fee"] = blockColumn<uint64_t>(stats, [](const RawBlockStats &s) { return s.fee; });
+        columns["input_value"] = blockColumn<uint64_t>(stats, [](const RawBlockStats &s) { return s.inputValue; });
+        columns["output_value"] = blockColumn<uint64_t>(stats, [](const RawBlockStats &s) { return s.outputValue; });
+        columns["input_count"] = blockColumn<uint32_t>(stats, [](const RawBlockStats &s) { return s.inputCount; });
+        columns["output_count"] = blockColumn<uint32_t>(stats, [](const RawBlockStats &s) { return s.outputCount; });
+        columns["segwit_tx_count"] = blockColumn<uint32_t>(stats, [](const RawBlockStats &s) { return s.segwitTxCount; });
+        columns["input_count_by_type"] = blockTypeColumns(stats, &RawBlockStats::inputCountByType);
+        columns["output_count_by_type"] = blockTypeColumns(stats, &RawBlockStats::outputCountByType);
+        columns["input_value_by_type"] = blockTypeColumns(stats, &RawBlockStats::inputValueByType);
+        columns["output_value_by_type"] = blockTypeColumns(stats, &RawBlockStats::outputValueByType);
+        return columns;
+    }, py::arg("start") = 0, py::arg("stop") = std::numeric_limits<BlockHeight>::max(), R"docstring(
+         Returns the per block stats recorded by the parser for blocks in [start, stop) as a dict of numpy arrays.
+         The *_by_type arrays have one column per address type, ordered by the value of address_type.
+         
+         :param int start: The first block height.
+         :param int stop: The end of the block range.
+         :returns: dict
+         )docstring")
+    .def("utxo_set", [](const Blockchain &chain, BlockHeight height) {
+        auto utxos = getUTXOSet(height, chain.getAccess());
+        py::dict columns;
+        columns["tx_index"] = toNumpyArray(std::move(utxos.txNums));
+        columns["output_index"] = toNumpyArray(std::move(utxos.outputNums));
+        columns["value"] = toNumpyArray(std::move(utxos.values));
+        columns["address_type"] = toNumpyArray(std::move(utxos.addressTypes));
+        columns["address_num"] = toNumpyArray(std::move(utxos.scriptNums));
+        return columns;
+    }, py::arg("height"), R"docstring(
+         Returns the outputs that were unspent once the block at the given height was added, as a dict of numpy
+         arrays sorted by output. Uses the UTXO snapshots if they were built with the parser's utxo-snapshot-update
+         command, and otherwise scans every output up to the height.
+         
+         :param int height: The block height.
+         :returns: dict
+         )docstring")
     .def_property_readonly("outputs_unspent", [](const Blockchain &chain) -> ranges::any_view<Output> { return outputsUnspent(chain); }, "Returns a list of all of the outputs that are unspent")
     .def("tx_with_index", [](const Blockchain &chain, uint32_t index) {
         return Transaction{index, chain.getAccess()};
@@ -113,6 +207,18 @@ void init_blockchain(py::module &m) {
             pyAddresses.append(address.getScript().wrapped);
         }
         return pyAddresses;
-    }, "Find all addresses beginning with the given prefix")
+    }, "Find all P2PKH, P2SH, P2WPKH and P2WSH addresses beginning with the given prefix. Uses the address prefix index if it was built with the parser's prefix-index-update command, and otherwise scans every address, returning the same addresses in a different order. Script hashes only match as the type they were used as, so segwit script hashes match as P2WSH and never as P2SH")
+    .def("encode_addresses", [](const Blockchain &, const std::vector<Address> &addresses) {
+        auto strings = encodeAddresses(addresses);
+        py::list pyStrings;
+        for (auto &string : strings) {
+            if (string.empty()) {
+                pyStrings.append(py::none());
+            } else {
+                pyStrings.append(py::str(string.chars, string.length));
+            }
+        }
+        return pyStrings;
+    }, "Encode a list of addresses to their address strings in a single batch, returning None for addresses without a string form")
     ;
 }
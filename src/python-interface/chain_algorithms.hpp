@@ -16,14 +16,31 @@
 #include <blocksci/chain/output.hpp>
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 
 #include <range/v3/view/any_view.hpp>
 #include <range/v3/view/filter.hpp>
 #include <range/v3/algorithm/any_of.hpp>
 #include <range/v3/algorithm/all_of.hpp>
 
+#include <memory>
+#include <vector>
+
 #include <stdio.h>
 
+// Hands the vector's buffer to numpy without copying it
+template <typename T>
+pybind11::array_t<T> toNumpyArray(std::vector<T> &&values) {
+    auto owned = std::make_unique<std::vector<T>>(std::move(values));
+    auto data = owned->data();
+    auto size = owned->size();
+    pybind11::capsule owner(owned.get(), [](void *ptr) {
+        delete static_cast<std::vector<T> *>(ptr);
+    });
+    owned.release();
+    return pybind11::array_t<T>(size, data, owner);
+}
+
 template<typename Class>
 void addTxAlgorithms(pybind11::module &m, Class & cl) {
     using Range = typename Class::type;
@@ -39,7 +56,7 @@ template<typename Class>
 void addTxRangeAlgorithms(pybind11::module &m, Class & cl) {
     using Range = typename Class::type;
     
-    m.def("fee", [](Range &range) { return fees(range) | ranges::to_vector; }, "Returns a list of all of the outputs in this range that are still unspent");
+    m.def("fee", [](Range &range) { return toNumpyArray(collectFees(range)); }, "Returns a numpy array of the fee paid by each transaction");
 }
 
 template<typename Class>
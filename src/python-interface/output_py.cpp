@@ -49,6 +49,9 @@ void addOutputMethods(Class &cl, FuncApplication func, FuncDoc func2) {
     .def_property_readonly("spending_tx", func([](const Output &output) {
         return output.getSpendingTx();
     }), func2("Returns the transaction that spent this output or None if it is unspent"))
+    .def_property_readonly("spending_input", func([](const Output &output) {
+        return output.getSpendingInput();
+    }), func2("Returns the input that spent this output or None if it is unspent"))
     .def_property_readonly("tx", func([](const Output &output) {
         return output.transaction();
     }), func2("The transaction that contains this input"))
@@ -0,0 +1,129 @@
+//
+//  address_encoder_test.cpp
+//  blocksci
+//
+
+#include <blocksci/address/address_encoder.hpp>
+#include <blocksci/scripts/bitcoin_base58.hpp>
+#include <blocksci/scripts/bitcoin_segwit_addr.hpp>
+#include <blocksci/util/data_configuration.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Checks AddressEncoder against the encoding addressString() uses for every address type: CBitcoinAddress for
+ * base58 addresses and segwit_addr for witness addresses. Runs with mainnet, testnet and two byte version
+ * prefixes, over hashes with leading zero bytes and more addresses than one checksum batch holds.
+ */
+
+using namespace blocksci;
+
+namespace {
+    int failures = 0;
+
+    void check(bool passed, const std::string &name) {
+        if (!passed) {
+            std::cerr << "FAILED " << name << "\n";
+            failures++;
+        }
+    }
+
+    DataConfiguration makeConfig(std::vector<unsigned char> pubkeyPrefix, std::vector<unsigned char> scriptPrefix, std::string segwitPrefix) {
+        DataConfiguration config;
+        config.pubkeyPrefix = std::move(pubkeyPrefix);
+        config.scriptPrefix = std::move(scriptPrefix);
+        config.segwitPrefix = std::move(segwitPrefix);
+        return config;
+    }
+
+    std::vector<uint256> makeHashes() {
+        std::vector<uint256> hashes;
+        for (size_t zeroes = 0; zeroes <= 32; zeroes++) {
+            uint256 hash;
+            for (size_t i = zeroes; i < 32; i++) {
+                hash.begin()[i] = static_cast<unsigned char>((i + 1) * 37 + zeroes * 11);
+            }
+            hashes.push_back(hash);
+        }
+        uint256 allOnes;
+        memset(allOnes.begin(), 0xff, 32);
+        hashes.push_back(allOnes);
+        for (size_t seed = 0; seed < 40; seed++) {
+            uint256 hash;
+            for (size_t i = 0; i < 32; i++) {
+                hash.begin()[i] = static_cast<unsigned char>(seed * 97 + i * i * 13 + 5);
+            }
+            hashes.push_back(hash);
+        }
+        return hashes;
+    }
+
+    // The string addressString() gives for an address of type whose script data holds hash
+    std::string expectedString(AddressType::Enum type, const uint256 &hash, const DataConfiguration &config) {
+        uint160 hash160;
+        memcpy(hash160.begin(), hash.begin(), sizeof(hash160));
+        switch (type) {
+            case AddressType::Enum::PUBKEY:
+            case AddressType::Enum::PUBKEYHASH:
+            case AddressType::Enum::MULTISIG_PUBKEY:
+            case AddressType::Enum::SCRIPTHASH:
+                return CBitcoinAddress(hash160, type, config).ToString();
+            case AddressType::Enum::WITNESS_PUBKEYHASH:
+                return segwit_addr::encode(config, 0, std::vector<uint8_t>(hash.begin(), hash.begin() + sizeof(hash160)));
+            case AddressType::Enum::WITNESS_SCRIPTHASH:
+                return segwit_addr::encode(config, 0, std::vector<uint8_t>(hash.begin(), hash.end()));
+            default:
+                return "";
+        }
+    }
+
+    void testConfig(const std::string &name, const DataConfiguration &config) {
+        auto hashes = makeHashes();
+        std::vector<AddressType::Enum> types;
+        std::vector<uint256> typeHashes;
+        for (auto type : AddressType::all) {
+            for (auto &hash : hashes) {
+                types.push_back(type);
+                typeHashes.push_back(hash);
+            }
+        }
+
+        AddressEncoder encoder(config);
+        std::vector<AddressString> strings(types.size());
+        encoder.encode(types.data(), typeHashes.data(), types.size(), strings.data());
+        for (size_t i = 0; i < types.size(); i++) {
+            auto expected = expectedString(types[i], typeHashes[i], config);
+            if (strings[i].str() != expected) {
+                std::cerr << name << " type " << static_cast<int>(types[i]) << ": expected " << expected << " got " << strings[i].str() << "\n";
+                check(false, name);
+                return;
+            }
+        }
+
+        // Single addresses take the same path as a partly filled batch
+        bool matches = true;
+        for (size_t i = 0; i < types.size(); i += 17) {
+            AddressString string;
+            encoder.encode(&types[i], &typeHashes[i], 1, &string);
+            matches = matches && string.str() == expectedString(types[i], typeHashes[i], config);
+        }
+        check(matches, name + " single addresses");
+    }
+}
+
+int main() {
+    testConfig("mainnet", makeConfig({0}, {5}, "bc"));
+    testConfig("testnet", makeConfig({111}, {196}, "tb"));
+    testConfig("regtest", makeConfig({111}, {196}, "bcrt"));
+    testConfig("two byte prefixes", makeConfig({28, 184}, {28, 189}, "zc"));
+    testConfig("litecoin", makeConfig({48}, {50}, "ltc"));
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All address encoder checks passed\n";
+    return 0;
+}
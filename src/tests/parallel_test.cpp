@@ -0,0 +1,155 @@
+//
+//  parallel_test.cpp
+//  blocksci
+//
+
+#include <blocksci/util/parallel.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Checks the pool primitives of parallel.hpp against serial loops. Every range is run on pools of several
+ * sizes, including empty ranges, reversed ranges and ranges with fewer items than the pool has threads.
+ */
+
+using namespace blocksci;
+
+namespace {
+    int failures = 0;
+
+    void check(bool passed, const std::string &name, unsigned int threads, uint64_t begin, uint64_t end) {
+        if (!passed) {
+            std::cerr << "FAILED " << name << " with " << threads << " threads over [" << begin << ", " << end << ")\n";
+            failures++;
+        }
+    }
+
+    uint64_t itemValue(uint64_t i) {
+        return i * 2654435761u + 17;
+    }
+
+    void testParallelFor(ThreadPool &pool, uint64_t begin, uint64_t end) {
+        auto count = end > begin ? end - begin : 0;
+        std::vector<std::atomic<uint32_t>> visits(count);
+        for (auto &visit : visits) {
+            visit.store(0);
+        }
+        std::atomic<bool> outOfRange{false};
+        parallelFor(pool, begin, end, [&](uint64_t i) {
+            if (i < begin || i >= end) {
+                outOfRange = true;
+                return;
+            }
+            visits[i - begin]++;
+        });
+        bool passed = !outOfRange;
+        for (auto &visit : visits) {
+            passed = passed && visit.load() == 1;
+        }
+        check(passed, "parallelFor", pool.size(), begin, end);
+    }
+
+    void testParallelCollect(ThreadPool &pool, uint64_t begin, uint64_t end) {
+        auto count = end > begin ? end - begin : 0;
+        std::vector<uint64_t> serial;
+        for (uint64_t i = begin; i < end; i++) {
+            serial.push_back(itemValue(i));
+        }
+        std::vector<uint64_t> parallel(count, 0);
+        parallelCollect(pool, begin, end, parallel.begin(), itemValue);
+        check(parallel == serial, "parallelCollect", pool.size(), begin, end);
+    }
+
+    void testParallelReduceChunks(ThreadPool &pool, uint64_t begin, uint64_t end) {
+        uint64_t serialSum = 0;
+        std::vector<uint64_t> serialOrder;
+        for (uint64_t i = begin; i < end; i++) {
+            serialSum += itemValue(i);
+            serialOrder.push_back(i);
+        }
+
+        auto sum = parallelReduceChunks(pool, begin, end, uint64_t{0}, [](uint64_t &acc, uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (auto i = chunkBegin; i < chunkEnd; i++) {
+                acc += itemValue(i);
+            }
+        }, [](uint64_t &total, const uint64_t &acc) {
+            total += acc;
+        });
+        check(sum == serialSum, "parallelReduceChunks sum", pool.size(), begin, end);
+
+        // Concatenation only matches the serial order if chunks cover the range once and are combined in order
+        auto order = parallelReduceChunks(pool, begin, end, std::vector<uint64_t>{}, [](std::vector<uint64_t> &acc, uint64_t chunkBegin, uint64_t chunkEnd) {
+            for (auto i = chunkBegin; i < chunkEnd; i++) {
+                acc.push_back(i);
+            }
+        }, [](std::vector<uint64_t> &total, const std::vector<uint64_t> &acc) {
+            total.insert(total.end(), acc.begin(), acc.end());
+        });
+        check(order == serialOrder, "parallelReduceChunks order", pool.size(), begin, end);
+
+        auto reduced = parallelReduce(pool, begin, end, uint64_t{0}, [](uint64_t &acc, uint64_t i) {
+            acc += itemValue(i);
+        }, [](uint64_t &total, const uint64_t &acc) {
+            total += acc;
+        });
+        check(reduced == serialSum, "parallelReduce", pool.size(), begin, end);
+    }
+
+    void testException(ThreadPool &pool) {
+        bool caught = false;
+        try {
+            parallelFor(pool, 0, 1000, [](uint64_t i) {
+                if (i == 517) {
+                    throw std::runtime_error("expected");
+                }
+            });
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        check(caught, "parallelFor exception", pool.size(), 0, 1000);
+    }
+
+    void testNested(ThreadPool &pool) {
+        std::atomic<uint64_t> total{0};
+        parallelFor(pool, 0, 64, [&](uint64_t i) {
+            auto inner = parallelReduce(pool, 0, i, uint64_t{0}, [](uint64_t &acc, uint64_t j) {
+                acc += j;
+            }, [](uint64_t &sum, const uint64_t &acc) {
+                sum += acc;
+            });
+            total += inner;
+        });
+        uint64_t serial = 0;
+        for (uint64_t i = 0; i < 64; i++) {
+            serial += i * (i - 1) / 2;
+        }
+        check(total == serial, "nested parallelReduce", pool.size(), 0, 64);
+    }
+}
+
+int main() {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges = {
+        {0, 0}, {42, 42}, {10, 3}, {0, 1}, {5, 7}, {100, 103}, {0, 1000}, {12345, 112345}
+    };
+    for (unsigned int threads : {1u, 2u, 3u, 8u, 32u}) {
+        ThreadPool pool(threads);
+        for (auto &range : ranges) {
+            testParallelFor(pool, range.first, range.second);
+            testParallelCollect(pool, range.first, range.second);
+            testParallelReduceChunks(pool, range.first, range.second);
+        }
+        testException(pool);
+        testNested(pool);
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All parallel checks passed\n";
+    return 0;
+}
@@ -0,0 +1,306 @@
+//
+//  rpc_block_fetcher_test.cpp
+//  blocksci
+//
+
+#include <parser/rpc_block_fetcher.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Runs RPCBlockFetcher against a mock node serving canned getblockhash and getblock responses over a local
+ * socket. Checks that blocks arrive in order over several connections, that dropped requests are retried and
+ * that a block which keeps failing surfaces its error from nextBlock.
+ */
+
+namespace {
+    int failures = 0;
+
+    void check(bool passed, const std::string &name) {
+        if (!passed) {
+            std::cerr << "FAILED " << name << "\n";
+            failures++;
+        }
+    }
+
+    std::string blockHash(int height) {
+        return "hash" + std::to_string(height);
+    }
+
+    std::vector<std::string> blockTxes(int height) {
+        std::vector<std::string> txes;
+        for (int i = 0; i <= height % 3; i++) {
+            txes.push_back("tx" + std::to_string(height) + "_" + std::to_string(i));
+        }
+        return txes;
+    }
+
+    // Minimal HTTP JSON-RPC server answering one request per connection
+    class MockNode {
+        int listenFd;
+        int port;
+        std::atomic<bool> stopping{false};
+        std::thread thread;
+
+        std::mutex m;
+        std::map<std::string, int> getblockCounts;
+        // getblock requests for a hash that are dropped without a response before it is served
+        std::map<std::string, int> droppedRequests;
+        // getblock requests for a hash that always get an error response
+        std::map<std::string, bool> brokenHashes;
+
+        static std::string readRequest(int fd) {
+            std::string request;
+            char buffer[4096];
+            size_t bodyStart = std::string::npos;
+            size_t contentLength = 0;
+            while (bodyStart == std::string::npos || request.size() < bodyStart + contentLength) {
+                auto count = recv(fd, buffer, sizeof(buffer), 0);
+                if (count <= 0) {
+                    return "";
+                }
+                request.append(buffer, static_cast<size_t>(count));
+                if (bodyStart == std::string::npos) {
+                    auto headerEnd = request.find("\r\n\r\n");
+                    if (headerEnd != std::string::npos) {
+                        bodyStart = headerEnd + 4;
+                        std::string headers = request.substr(0, headerEnd);
+                        for (auto &c : headers) {
+                            c = static_cast<char>(std::tolower(c));
+                        }
+                        auto lengthPos = headers.find("content-length:");
+                        if (lengthPos != std::string::npos) {
+                            contentLength = std::stoul(headers.substr(lengthPos + 15));
+                        }
+                    }
+                }
+            }
+            return request.substr(bodyStart, contentLength);
+        }
+
+        static void sendResponse(int fd, int status, const Json::Value &response) {
+            auto body = Json::writeString(Json::StreamWriterBuilder{}, response);
+            std::stringstream ss;
+            ss << "HTTP/1.1 " << status << (status == 200 ? " OK" : " Internal Server Error") << "\r\n";
+            ss << "Content-Type: application/json\r\nConnection: close\r\nContent-Length: " << body.size() << "\r\n\r\n" << body;
+            auto data = ss.str();
+            size_t sent = 0;
+            while (sent < data.size()) {
+                auto count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (count <= 0) {
+                    return;
+                }
+                sent += static_cast<size_t>(count);
+            }
+        }
+
+        void handle(int fd) {
+            auto body = readRequest(fd);
+            Json::Value request;
+            std::string errors;
+            std::istringstream stream(body);
+            if (!Json::parseFromStream(Json::CharReaderBuilder{}, stream, &request, &errors)) {
+                return;
+            }
+            Json::Value response;
+            response["id"] = request["id"];
+            response["result"] = Json::Value(Json::nullValue);
+            response["error"] = Json::Value(Json::nullValue);
+            auto method = request["method"].asString();
+            auto &params = request["params"];
+            if (method == "getblockhash") {
+                response["result"] = blockHash(params[0].asInt());
+            } else if (method == "getblock") {
+                auto hash = params[0].asString();
+                bool broken;
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    getblockCounts[hash]++;
+                    if (droppedRequests[hash] > 0) {
+                        droppedRequests[hash]--;
+                        return;
+                    }
+                    broken = brokenHashes[hash];
+                }
+                if (broken) {
+                    response["error"]["code"] = -5;
+                    response["error"]["message"] = "Block not found";
+                    sendResponse(fd, 500, response);
+                    return;
+                }
+                auto height = std::stoi(hash.substr(4));
+                Json::Value block;
+                block["hash"] = hash;
+                block["height"] = height;
+                block["tx"] = Json::Value(Json::arrayValue);
+                for (auto &tx : blockTxes(height)) {
+                    block["tx"].append(tx);
+                }
+                response["result"] = block;
+            } else {
+                response["error"]["code"] = -32601;
+                response["error"]["message"] = "Method not found";
+                sendResponse(fd, 500, response);
+                return;
+            }
+            sendResponse(fd, 200, response);
+        }
+
+        void serve() {
+            while (!stopping) {
+                auto fd = accept(listenFd, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                handle(fd);
+                close(fd);
+            }
+        }
+
+    public:
+        MockNode() {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listenFd, 64) != 0) {
+                throw std::runtime_error("Could not start the mock node");
+            }
+            socklen_t length = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &length);
+            port = ntohs(addr.sin_port);
+            thread = std::thread(&MockNode::serve, this);
+        }
+
+        ~MockNode() {
+            stopping = true;
+            shutdown(listenFd, SHUT_RDWR);
+            thread.join();
+            close(listenFd);
+        }
+
+        int getPort() const {
+            return port;
+        }
+
+        void dropRequests(int height, int count) {
+            std::lock_guard<std::mutex> lock(m);
+            droppedRequests[blockHash(height)] = count;
+        }
+
+        void breakBlock(int height) {
+            std::lock_guard<std::mutex> lock(m);
+            brokenHashes[blockHash(height)] = true;
+        }
+
+        int getblockCount(int height) {
+            std::lock_guard<std::mutex> lock(m);
+            return getblockCounts[blockHash(height)];
+        }
+    };
+
+    using Fetcher = RPCBlockFetcher<std::vector<std::string>>;
+
+    std::vector<std::string> fetchTxes(BitcoinAPI &bapi, const BlockInfo<RPCTag> &block) {
+        return bapi.getblock(bapi.getblockhash(block.height)).tx;
+    }
+
+    ParserConfiguration<RPCTag> makeConfig(const MockNode &node) {
+        ParserConfiguration<RPCTag> config;
+        config.username = "user";
+        config.password = "password";
+        config.address = "127.0.0.1";
+        config.port = node.getPort();
+        config.connectionCount = 4;
+        config.blockLookahead = 3;
+        return config;
+    }
+
+    std::vector<BlockInfo<RPCTag>> makeBlocks(int count) {
+        std::vector<BlockInfo<RPCTag>> blocks(static_cast<size_t>(count));
+        for (int i = 0; i < count; i++) {
+            blocks[static_cast<size_t>(i)].height = i + 1;
+        }
+        return blocks;
+    }
+
+    void testFetchInOrder() {
+        MockNode node;
+        auto config = makeConfig(node);
+        auto blocks = makeBlocks(40);
+        Fetcher fetcher(config, blocks, fetchTxes);
+        bool matches = true;
+        for (auto &block : blocks) {
+            matches = matches && fetcher.nextBlock() == blockTxes(block.height);
+        }
+        check(matches, "blocks arrive in order");
+    }
+
+    void testRetry() {
+        MockNode node;
+        node.dropRequests(5, Fetcher::maxAttempts - 1);
+        auto config = makeConfig(node);
+        auto blocks = makeBlocks(10);
+        Fetcher fetcher(config, blocks, fetchTxes);
+        bool matches = true;
+        try {
+            for (auto &block : blocks) {
+                matches = matches && fetcher.nextBlock() == blockTxes(block.height);
+            }
+        } catch (const BitcoinException &) {
+            matches = false;
+        }
+        check(matches, "dropped requests are retried");
+        check(node.getblockCount(5) == Fetcher::maxAttempts, "retry count");
+    }
+
+    void testError() {
+        MockNode node;
+        node.breakBlock(7);
+        auto config = makeConfig(node);
+        auto blocks = makeBlocks(20);
+        bool caught = false;
+        bool matches = true;
+        {
+            Fetcher fetcher(config, blocks, fetchTxes);
+            try {
+                for (auto &block : blocks) {
+                    matches = matches && fetcher.nextBlock() == blockTxes(block.height);
+                    check(block.height < 7, "no block after the broken one");
+                }
+            } catch (const BitcoinException &) {
+                caught = true;
+            }
+        }
+        check(caught, "error surfaces from nextBlock");
+        check(matches, "blocks before the error");
+        check(node.getblockCount(7) == Fetcher::maxAttempts, "failing block is given up after maxAttempts");
+    }
+}
+
+int main() {
+    testFetchInOrder();
+    testRetry();
+    testError();
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All RPC block fetcher checks passed\n";
+    return 0;
+}
@@ -0,0 +1,88 @@
+//
+//  sha256_batch_test.cpp
+//  blocksci
+//
+
+#include <blocksci/util/hash.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Checks sha256Batch and doubleSha256Batch against the scalar OpenSSL hashes. Lengths cover the padding
+ * boundaries at 55, 56 and 64 bytes and multi block messages, and batch sizes leave partly filled lanes for
+ * both the 4 and 8 lane paths.
+ */
+
+namespace {
+    int failures = 0;
+
+    void check(bool passed, const std::string &name, size_t count) {
+        if (!passed) {
+            std::cerr << "FAILED " << name << " with " << count << " messages\n";
+            failures++;
+        }
+    }
+
+    std::vector<unsigned char> makeMessage(size_t length, size_t seed) {
+        std::vector<unsigned char> message(length);
+        for (size_t i = 0; i < length; i++) {
+            message[i] = static_cast<unsigned char>((i + 1) * 131 + seed * 71);
+        }
+        return message;
+    }
+
+    void testBatch(const std::vector<size_t> &lengths) {
+        std::vector<std::vector<unsigned char>> messages;
+        std::vector<const unsigned char *> pointers;
+        for (size_t i = 0; i < lengths.size(); i++) {
+            messages.push_back(makeMessage(lengths[i], i));
+        }
+        for (auto &message : messages) {
+            pointers.push_back(message.data());
+        }
+
+        std::vector<blocksci::uint256> hashes(lengths.size());
+        sha256Batch(pointers.data(), lengths.data(), hashes.data(), lengths.size());
+        bool matches = true;
+        for (size_t i = 0; i < lengths.size(); i++) {
+            matches = matches && hashes[i] == sha256(messages[i].data(), lengths[i]);
+        }
+        check(matches, "sha256Batch", lengths.size());
+
+        std::vector<blocksci::uint256> doubleHashes(lengths.size());
+        doubleSha256Batch(pointers.data(), lengths.data(), doubleHashes.data(), lengths.size());
+        matches = true;
+        for (size_t i = 0; i < lengths.size(); i++) {
+            matches = matches && doubleHashes[i] == doubleSha256(reinterpret_cast<const char *>(messages[i].data()), lengths[i]);
+        }
+        check(matches, "doubleSha256Batch", lengths.size());
+    }
+}
+
+int main() {
+    const std::vector<size_t> boundaryLengths = {0, 1, 31, 32, 54, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 129, 1000};
+
+    // Every boundary length alone and then filling every lane
+    for (auto length : boundaryLengths) {
+        testBatch({length});
+        testBatch(std::vector<size_t>(8, length));
+    }
+
+    // Mixed lengths so that lanes finish at different blocks, at every count up to a few full batches of 8
+    std::vector<size_t> lengths;
+    for (size_t count = 1; count <= 3 * 8 + 5; count++) {
+        lengths.push_back(boundaryLengths[(count * 7) % boundaryLengths.size()]);
+        testBatch(lengths);
+    }
+
+    testBatch({});
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All sha256 batch checks passed\n";
+    return 0;
+}
@@ -0,0 +1,117 @@
+//
+//  spending_input_test.cpp
+//  blocksci
+//
+
+#include <blocksci/chain/chain_access.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Checks spentOutputNums, which the parser uses to fill in the spending input column of older data. Inputs are
+ * matched to outputs by tx, address and value, so identical outputs spent by the same tx must not be paired with
+ * the wrong input.
+ */
+
+using namespace blocksci;
+
+namespace {
+    int failures = 0;
+
+    void check(bool passed, const std::string &name) {
+        if (!passed) {
+            std::cerr << "FAILED " << name << "\n";
+            failures++;
+        }
+    }
+
+    Inout makeInout(uint32_t linkedTxNum, uint32_t toAddressNum, uint64_t value) {
+        Inout inout;
+        inout.linkedTxNum = linkedTxNum;
+        inout.toAddressNum = toAddressNum;
+        inout.setType(AddressType::Enum::PUBKEYHASH);
+        inout.setValue(value);
+        return inout;
+    }
+
+    // Holds raw transactions laid out as in the tx file
+    class TxStore {
+        std::map<uint32_t, std::unique_ptr<uint64_t[]>> buffers;
+
+    public:
+        RawTransaction *add(uint32_t txNum, const std::vector<Inout> &inputs, const std::vector<Inout> &outputs) {
+            auto size = sizeof(RawTransaction) + sizeof(Inout) * (inputs.size() + outputs.size());
+            auto &buffer = buffers[txNum];
+            buffer.reset(new uint64_t[size / sizeof(uint64_t) + 1]);
+            auto tx = new (buffer.get()) RawTransaction(0, 0, 0, static_cast<uint16_t>(inputs.size()), static_cast<uint16_t>(outputs.size()));
+            for (uint16_t i = 0; i < inputs.size(); i++) {
+                tx->getInput(i) = inputs[i];
+            }
+            for (uint16_t i = 0; i < outputs.size(); i++) {
+                tx->getOutput(i) = outputs[i];
+            }
+            return tx;
+        }
+
+        const RawTransaction *get(uint32_t txNum) const {
+            return reinterpret_cast<const RawTransaction *>(buffers.at(txNum).get());
+        }
+
+        std::vector<uint16_t> spentOutputNums(uint32_t txNum) const {
+            return blocksci::spentOutputNums(*get(txNum), txNum, [&](uint32_t spentTxNum) { return get(spentTxNum); });
+        }
+    };
+
+    void testDistinctOutputs() {
+        TxStore store;
+        // Inputs in the opposite order of the outputs they spend
+        store.add(1, {}, {makeInout(2, 10, 500), makeInout(2, 11, 700)});
+        store.add(2, {makeInout(1, 11, 700), makeInout(1, 10, 500)}, {});
+        check(store.spentOutputNums(2) == std::vector<uint16_t>{1, 0}, "distinct outputs");
+    }
+
+    void testDuplicateOutputs() {
+        TxStore store;
+        // Outputs 0 and 1 are identical and both spent by tx 2, output 3 is identical but unspent
+        store.add(1, {}, {makeInout(2, 10, 500), makeInout(2, 10, 500), makeInout(2, 11, 300), makeInout(0, 10, 500)});
+        store.add(2, {makeInout(1, 10, 500), makeInout(1, 11, 300), makeInout(1, 10, 500)}, {});
+        check(store.spentOutputNums(2) == std::vector<uint16_t>{unknownSpendingInput, 2, unknownSpendingInput}, "duplicate outputs spent by one tx");
+    }
+
+    void testDuplicateOutputsSpentSeparately() {
+        TxStore store;
+        // Identical outputs spent by different txes are told apart by the spending tx
+        store.add(1, {}, {makeInout(3, 10, 500), makeInout(2, 10, 500), makeInout(0, 10, 500)});
+        store.add(2, {makeInout(1, 10, 500)}, {});
+        store.add(3, {makeInout(1, 10, 500)}, {});
+        check(store.spentOutputNums(2) == std::vector<uint16_t>{1}, "duplicate outputs spent separately");
+        check(store.spentOutputNums(3) == std::vector<uint16_t>{0}, "duplicate outputs spent separately");
+    }
+
+    void testSameAddressAndValueFromDifferentTxes() {
+        TxStore store;
+        // Inputs sharing address and value but spending different txes are not ambiguous
+        store.add(1, {}, {makeInout(3, 10, 500)});
+        store.add(2, {}, {makeInout(0, 10, 500), makeInout(3, 10, 500)});
+        store.add(3, {makeInout(2, 10, 500), makeInout(1, 10, 500)}, {});
+        check(store.spentOutputNums(3) == std::vector<uint16_t>{1, 0}, "same address and value from different txes");
+    }
+}
+
+int main() {
+    testDistinctOutputs();
+    testDuplicateOutputs();
+    testDuplicateOutputsSpentSeparately();
+    testSameAddressAndValueFromDifferentTxes();
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All spending input checks passed\n";
+    return 0;
+}
@@ -0,0 +1,320 @@
+//
+//  main.cpp
+//  blocksci_warmup
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/util/data_configuration.hpp>
+
+#include <clipp.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Files are warmed a group at a time, in the order that queries tend to need them
+    enum class WarmupGroup {
+        Index, Transactions, Scripts, RocksDB
+    };
+
+    const char *groupName(WarmupGroup group) {
+        switch (group) {
+            case WarmupGroup::Index: return "index";
+            case WarmupGroup::Transactions: return "transactions";
+            case WarmupGroup::Scripts: return "scripts";
+            case WarmupGroup::RocksDB: return "rocksdb";
+        }
+        return "";
+    }
+
+    struct WarmupFile {
+        boost::filesystem::path path;
+        uint64_t size;
+        WarmupGroup group;
+        uint64_t residentBefore = 0;
+        uint64_t residentAfter = 0;
+    };
+
+#ifdef __APPLE__
+    using MincoreEntry = char;
+#else
+    using MincoreEntry = unsigned char;
+#endif
+
+    // Number of bytes of the file currently in the page cache
+    uint64_t residentBytes(const WarmupFile &file) {
+        if (file.size == 0) {
+            return 0;
+        }
+        int fd = open(file.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + file.path.native());
+        }
+        void *addr = mmap(nullptr, file.size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + file.path.native());
+        }
+        auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        auto pageCount = (file.size + pageSize - 1) / pageSize;
+        std::vector<MincoreEntry> pages(pageCount);
+        auto result = mincore(addr, file.size, pages.data());
+        munmap(addr, file.size);
+        if (result != 0) {
+            throw std::runtime_error("Could not check residency of " + file.path.native());
+        }
+        uint64_t residentPages = 0;
+        for (auto page : pages) {
+            residentPages += page & 1;
+        }
+        return std::min(residentPages * pageSize, file.size);
+    }
+
+    class WarmupPlan {
+        std::vector<WarmupFile> files;
+        std::set<boost::filesystem::path> seen;
+
+    public:
+        void add(const boost::filesystem::path &path, WarmupGroup group) {
+            if (!boost::filesystem::is_regular_file(path) || !seen.insert(path).second) {
+                return;
+            }
+            files.push_back(WarmupFile{path, boost::filesystem::file_size(path), group});
+        }
+
+        void addDirectory(const boost::filesystem::path &dir, WarmupGroup group) {
+            if (!boost::filesystem::is_directory(dir)) {
+                return;
+            }
+            std::vector<boost::filesystem::path> paths;
+            for (auto &entry : boost::filesystem::recursive_directory_iterator(dir)) {
+                paths.push_back(entry.path());
+            }
+            std::sort(paths.begin(), paths.end());
+            for (auto &path : paths) {
+                add(path, group);
+            }
+        }
+
+        std::vector<WarmupFile> &getFiles() {
+            return files;
+        }
+    };
+
+    WarmupPlan makePlan(const blocksci::DataConfiguration &config) {
+        auto dat = [](boost::filesystem::path path) {
+            return path.concat(".dat");
+        };
+        auto indexed = [](boost::filesystem::path path, const char *suffix) {
+            return path.concat(suffix).concat(".dat");
+        };
+
+        WarmupPlan plan;
+        plan.add(dat(config.blockFilePath()), WarmupGroup::Index);
+        plan.add(indexed(config.txFilePath(), "_index"), WarmupGroup::Index);
+        plan.add(dat(config.txHeightsFilePath()), WarmupGroup::Index);
+        plan.add(dat(config.blockStatsFilePath()), WarmupGroup::Index);
+
+        plan.add(indexed(config.txFilePath(), "_data"), WarmupGroup::Transactions);
+        plan.add(dat(config.txHashesFilePath()), WarmupGroup::Transactions);
+        plan.add(dat(config.txFeesFilePath()), WarmupGroup::Transactions);
+        plan.add(dat(config.txInputValuesFilePath()), WarmupGroup::Transactions);
+        plan.add(dat(config.txOutputValuesFilePath()), WarmupGroup::Transactions);
+        plan.addDirectory(config.chainDirectory(), WarmupGroup::Transactions);
+
+        plan.addDirectory(config.scriptsDirectory(), WarmupGroup::Scripts);
+
+        plan.addDirectory(config.hashIndexFilePath(), WarmupGroup::RocksDB);
+        plan.addDirectory(config.addressDBFilePath(), WarmupGroup::RocksDB);
+        return plan;
+    }
+
+    // Reads every file in the group into the page cache, splitting them into chunks shared between threads
+    void readGroup(std::vector<WarmupFile *> &groupFiles, int threadCount, uint64_t chunkSize) {
+        struct Chunk {
+            size_t fileNum;
+            uint64_t offset;
+        };
+
+        std::vector<int> fds;
+        std::vector<Chunk> chunks;
+        for (size_t i = 0; i < groupFiles.size(); i++) {
+            int fd = open(groupFiles[i]->path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                for (auto openFd : fds) {
+                    close(openFd);
+                }
+                throw std::runtime_error("Could not open " + groupFiles[i]->path.native());
+            }
+            fds.push_back(fd);
+            for (uint64_t offset = 0; offset < groupFiles[i]->size; offset += chunkSize) {
+                chunks.push_back(Chunk{i, offset});
+            }
+        }
+
+        std::atomic<size_t> nextChunk{0};
+        auto readLoop = [&]() {
+            std::vector<char> buffer(chunkSize);
+            while (true) {
+                auto chunkNum = nextChunk.fetch_add(1);
+                if (chunkNum >= chunks.size()) {
+                    return;
+                }
+                auto &chunk = chunks[chunkNum];
+                auto toRead = std::min(chunkSize, groupFiles[chunk.fileNum]->size - chunk.offset);
+                uint64_t done = 0;
+                while (done < toRead) {
+                    auto count = pread(fds[chunk.fileNum], buffer.data(), toRead - done, static_cast<off_t>(chunk.offset + done));
+                    if (count <= 0) {
+                        break;
+                    }
+                    done += static_cast<uint64_t>(count);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            threads.emplace_back(readLoop);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (auto fd : fds) {
+            close(fd);
+        }
+    }
+
+    void printResidency(const blocksci::DataConfiguration &config, const std::vector<WarmupFile> &files, bool afterWarmup) {
+        auto toMB = [](uint64_t bytes) {
+            return static_cast<double>(bytes) / (1024 * 1024);
+        };
+        auto percent = [](uint64_t resident, uint64_t size) {
+            return size == 0 ? 100.0 : 100.0 * static_cast<double>(resident) / static_cast<double>(size);
+        };
+        uint64_t totalSize = 0;
+        uint64_t totalBefore = 0;
+        uint64_t totalAfter = 0;
+        std::cout << std::fixed << std::setprecision(1);
+        for (auto &file : files) {
+            auto relative = file.path.native().substr(config.dataDirectory.native().size() + 1);
+            std::cout << std::setw(13) << groupName(file.group) << "  " << std::setw(10) << toMB(file.size) << " MB  " << std::setw(5) << percent(file.residentBefore, file.size) << "%";
+            if (afterWarmup) {
+                std::cout << " -> " << std::setw(5) << percent(file.residentAfter, file.size) << "%";
+            }
+            std::cout << "  " << relative << "\n";
+            totalSize += file.size;
+            totalBefore += file.residentBefore;
+            totalAfter += file.residentAfter;
+        }
+        std::cout << std::setw(13) << "total" << "  " << std::setw(10) << toMB(totalSize) << " MB  " << std::setw(5) << percent(totalBefore, totalSize) << "%";
+        if (afterWarmup) {
+            std::cout << " -> " << std::setw(5) << percent(totalAfter, totalSize) << "%";
+        }
+        std::cout << std::endl;
+    }
+
+    // Maps and locks the index files into memory. The locks only last while the process is alive
+    std::vector<std::pair<void *, uint64_t>> lockIndexFiles(const std::vector<WarmupFile> &files) {
+        std::vector<std::pair<void *, uint64_t>> locked;
+        for (auto &file : files) {
+            if (file.group != WarmupGroup::Index || file.size == 0) {
+                continue;
+            }
+            int fd = open(file.path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open " + file.path.native());
+            }
+            void *addr = mmap(nullptr, file.size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (addr == MAP_FAILED) {
+                throw std::runtime_error("Could not map " + file.path.native());
+            }
+            if (mlock(addr, file.size) != 0) {
+                std::cerr << "Could not lock " << file.path.native() << ", check the memlock limit (ulimit -l)" << std::endl;
+                munmap(addr, file.size);
+                continue;
+            }
+            locked.emplace_back(addr, file.size);
+        }
+        return locked;
+    }
+}
+
+int main(int argc, char * argv[]) {
+    std::string dataDirectoryString;
+    int threadCount = 32;
+    int chunkSizeKB = 1024;
+    bool reportOnly = false;
+    bool lockIndex = false;
+
+    auto cli = (
+        clipp::value("data directory", dataDirectoryString) % "Path to the BlockSci data directory",
+        (clipp::option("--threads", "-t") & clipp::value("threads", threadCount)) % "Number of concurrent reads",
+        (clipp::option("--chunk-size") & clipp::value("KB", chunkSizeKB)) % "Size of each read in kilobytes",
+        clipp::option("--report").set(reportOnly) % "Only report page cache residency without reading anything",
+        clipp::option("--lock-index").set(lockIndex) % "Lock the block and transaction index files in memory and wait until interrupted"
+    );
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error()) {
+        std::cout << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    boost::filesystem::path dataDirectory = {dataDirectoryString};
+    dataDirectory = boost::filesystem::absolute(dataDirectory);
+    blocksci::DataConfiguration config{dataDirectory, false, 0};
+
+    auto plan = makePlan(config);
+    auto &files = plan.getFiles();
+    for (auto &file : files) {
+        file.residentBefore = residentBytes(file);
+    }
+
+    if (reportOnly) {
+        printResidency(config, files, false);
+        return 0;
+    }
+
+    auto chunkSize = static_cast<uint64_t>(std::max(chunkSizeKB, 4)) * 1024;
+    for (auto group : {WarmupGroup::Index, WarmupGroup::Transactions, WarmupGroup::Scripts, WarmupGroup::RocksDB}) {
+        std::vector<WarmupFile *> groupFiles;
+        for (auto &file : files) {
+            if (file.group == group && file.residentBefore < file.size) {
+                groupFiles.push_back(&file);
+            }
+        }
+        std::cout << "Warming " << groupName(group) << " files" << std::endl;
+        readGroup(groupFiles, std::max(threadCount, 1), chunkSize);
+    }
+
+    for (auto &file : files) {
+        file.residentAfter = residentBytes(file);
+    }
+    printResidency(config, files, true);
+
+    if (lockIndex) {
+        auto locked = lockIndexFiles(files);
+        std::cout << "Locked " << locked.size() << " index files in memory, interrupt to release them" << std::endl;
+        while (true) {
+            pause();
+        }
+    }
+
+    return 0;
+}